@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <algorithm>
+#include "AnalysisBudget.h"
+
+size_t AnalysisBudget::Limits::operator[](Resource r) const {
+    switch(r) {
+        case TIME: return milliseconds;
+        case STATES: return states;
+        case PATHS: return paths;
+        case BYTES: return bytes;
+        default: assert(false); return 0;
+    }
+}
+
+AnalysisBudget::Usage AnalysisBudget::Usage::operator-(const Usage &rhs) const {
+    Usage rtn;
+    for(size_t r = 0;r < RESOURCE_COUNT;r++)
+        rtn.amounts[r] = amounts[r] - rhs.amounts[r];
+    return rtn;
+}
+
+AnalysisBudget::AnalysisBudget(const Limits &limits) : limits(limits), start(Clock::now()), exhausted(0) {
+    deadline = start + std::chrono::milliseconds(limits.milliseconds);
+    for(auto& u : used)
+        u = 0;
+}
+
+AnalysisBudget::AnalysisBudget(const AnalysisBudget &rhs)
+        : limits(rhs.limits), start(rhs.start), deadline(rhs.deadline), exhausted(rhs.exhausted.load()),
+          capped(rhs.capped) {
+    for(size_t r = 0;r < RESOURCE_COUNT;r++)
+        used[r] = rhs.used[r].load();
+}
+
+AnalysisBudget AnalysisBudget::Remaining(const AnalysisBudget &parent) {
+    return Remaining(parent, Limits());
+}
+
+AnalysisBudget AnalysisBudget::Remaining(const AnalysisBudget &parent, const Limits &cap) {
+    AnalysisBudget rtn(parent);
+    auto& limits = rtn.limits;
+    rtn.capped = 0;
+    // A limit of 0 is none, so anything already spent leaves at least 1
+    auto left = [&](Resource r) {
+        auto limit = limits[r] ? std::max<size_t>(limits[r] - std::min(limits[r], parent.Used(r)), 1) : 0;
+        if(cap[r] && (!limit || cap[r] < limit)) {
+            rtn.capped |= 1u << r;
+            return cap[r];
+        }
+        return limit;
+    };
+    limits.states = left(STATES);
+    limits.paths = left(PATHS);
+    limits.bytes = left(BYTES);
+    for(size_t r = STATES;r < RESOURCE_COUNT;r++)
+        rtn.used[r] = 0;
+
+    // Time is kept from the parent's start, so a capped deadline still
+    // reads as milliseconds since then
+    if(cap.milliseconds) {
+        auto capDeadline = Clock::now() + std::chrono::milliseconds(cap.milliseconds);
+        if(!limits.milliseconds || capDeadline < rtn.deadline) {
+            rtn.deadline = capDeadline;
+            limits.milliseconds = std::max<size_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(capDeadline - rtn.start).count(), 1);
+            rtn.capped |= 1u << TIME;
+        }
+    }
+    return rtn;
+}
+
+bool AnalysisBudget::Charge(Resource r, size_t amount) {
+    auto total = used[r] += amount;
+    if(limits[r] && total > limits[r])
+        Exhaust(r);
+    return exhausted == 0;
+}
+
+bool AnalysisBudget::IsExhausted() {
+    if(limits.milliseconds && !IsExhausted(TIME) && Clock::now() > deadline) {
+        used[TIME] = Used(TIME);
+        Exhaust(TIME);
+    }
+    return exhausted != 0;
+}
+
+size_t AnalysisBudget::Used(Resource r) const {
+    if(r == TIME && !IsExhausted(TIME))
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    return used[r];
+}
+
+AnalysisBudget::Usage AnalysisBudget::Used() const {
+    Usage rtn;
+    for(size_t r = 0;r < RESOURCE_COUNT;r++)
+        rtn.amounts[r] = Used((Resource)r);
+    return rtn;
+}
+
+const char* AnalysisBudget::Name(Resource r) {
+    switch(r) {
+        case TIME: return "milliseconds";
+        case STATES: return "states";
+        case PATHS: return "paths";
+        case BYTES: return "bytes";
+        default: return "?";
+    }
+}
+
+std::ostream &AnalysisBudget::Stream(std::ostream &os, const Usage &spent) const {
+    for(size_t i = 0;i < RESOURCE_COUNT;i++) {
+        auto r = (Resource)i;
+        // Elapsed time differs run to run; only show it once it ran out
+        if(r == TIME && !IsExhausted(r))
+            continue;
+        // The deadline is for the whole analysis, so show all the time it took
+        os << "\t" << Name(r) << ": " << std::dec << (r == TIME ? Used(r) : spent[r]);
+        if(Limit(r))
+            os << " of " << Limit(r);
+        if(IsExhausted(r))
+            os << " (exhausted)";
+        os << std::endl;
+    }
+    return os;
+}
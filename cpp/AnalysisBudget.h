@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+/***
+ * What one contract's analysis may spend, shared with the contracts it
+ * creates. The solver charges it as it goes; once anything runs out the
+ * budget stays exhausted and the analysis winds down with what it has.
+ *
+ * Bytes are the solver's own estimate of what its states, paths and
+ * constants hold, not a count of real allocations.
+ */
+class AnalysisBudget {
+public:
+    enum Resource {
+        TIME,       // milliseconds
+        STATES,
+        PATHS,
+        BYTES,
+        RESOURCE_COUNT
+    };
+
+    // 0 is no limit
+    struct Limits {
+        size_t milliseconds = 0;
+        size_t states = 0;
+        size_t paths = 0;
+        size_t bytes = 0;
+
+        size_t operator[](Resource r) const;
+    };
+
+    // Counters at one point; the difference of two is what was spent between
+    struct Usage {
+        size_t amounts[RESOURCE_COUNT] = {};
+
+        size_t operator[](Resource r) const { return amounts[r]; }
+        Usage operator-(const Usage& rhs) const;
+    };
+
+    explicit AnalysisBudget(const Limits& limits);
+    // What is left of parent, with the same deadline. Charging it does not
+    // charge parent.
+    static AnalysisBudget Remaining(const AnalysisBudget& parent);
+    // Same, but held to cap where that is tighter
+    static AnalysisBudget Remaining(const AnalysisBudget& parent, const Limits& cap);
+
+    AnalysisBudget(const AnalysisBudget& rhs);
+
+    // Returns false once the budget is exhausted, by this or anything else
+    bool Charge(Resource r, size_t amount);
+    void Exhaust(Resource r) { exhausted |= 1u << r; }
+    // Also checks the clock
+    bool IsExhausted();
+    bool IsExhausted(Resource r) const { return exhausted & (1u << r); }
+    // Limited by the cap given to Remaining rather than by the parent
+    bool IsCapped(Resource r) const { return capped & (1u << r); }
+
+    size_t Used(Resource r) const;
+    Usage Used() const;
+    size_t Limit(Resource r) const { return limits[r]; }
+    static const char* Name(Resource r);
+
+    // One line per resource: spent, the limit and whether it ran out
+    std::ostream& Stream(std::ostream& os, const Usage& spent) const;
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Limits limits;
+    Clock::time_point start, deadline;
+    std::atomic<size_t> used[RESOURCE_COUNT];
+    std::atomic<uint32_t> exhausted;
+    uint32_t capped = 0;
+};
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "AnalysisCache.h"
+
+static const char* const BYTECODE_FILE = "bytecode";
+static const char* const CREATES_FILE = "creates";
+
+static bool readWhole(const std::string& path, std::string& contents) {
+    std::ifstream fs(path, std::ios::binary);
+    if(!fs)
+        return false;
+    std::stringstream ss;
+    ss << fs.rdbuf();
+    contents = ss.str();
+    return true;
+}
+
+static bool writeWhole(const std::string& path, const std::string& contents) {
+    std::ofstream fs(path, std::ios::binary);
+    fs.write(contents.data(), contents.size());
+    return (bool)fs;
+}
+
+static std::vector<std::string> listFiles(const std::string& dir) {
+    std::vector<std::string> rtn;
+    if(DIR* d = opendir(dir.c_str())) {
+        while(auto entry = readdir(d)) {
+            struct stat st = {};
+            if(stat((dir + "/" + entry->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode))
+                rtn.push_back(entry->d_name);
+        }
+        closedir(d);
+    }
+    return rtn;
+}
+
+static void removeFlatDir(const std::string& dir) {
+    for(auto& f : listFiles(dir))
+        unlink((dir + "/" + f).c_str());
+    rmdir(dir.c_str());
+}
+
+AnalysisCache::AnalysisCache(const std::string &root, const std::string &salt) : root(root), salt(salt) {
+    mkdir(root.c_str(), S_IRWXU);
+}
+
+std::string AnalysisCache::Key(const std::vector<uint8_t> &byteCode) const {
+    // FNV-1a; collisions are caught by comparing the stored bytecode
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint8_t b) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    };
+    for(const char* v = ANALYZER_VERSION;*v;v++)
+        mix(*v);
+    for(auto c : salt)
+        mix(c);
+    for(auto b : byteCode)
+        mix(b);
+
+    std::stringstream ss;
+    ss.width(16); ss.fill('0');
+    ss << std::hex << hash << "-" << std::dec << byteCode.size();
+    return ss.str();
+}
+
+std::string AnalysisCache::entryDir(const std::string &key) const {
+    return root + "/" + key;
+}
+
+bool AnalysisCache::Has(const std::vector<uint8_t> &byteCode) const {
+    std::string stored;
+    if(!readWhole(entryDir(Key(byteCode)) + "/" + BYTECODE_FILE, stored))
+        return false;
+    return stored.size() == byteCode.size() &&
+           std::equal(byteCode.begin(), byteCode.end(), stored.begin(),
+                      [](uint8_t a, char b) { return a == (uint8_t)b; });
+}
+
+bool AnalysisCache::isComplete(const std::string &key) const {
+    std::string creates;
+    if(!readWhole(entryDir(key) + "/" + CREATES_FILE, creates))
+        return false;
+
+    std::stringstream ss(creates);
+    std::string childKey;
+    while(ss >> childKey) {
+        if(!isComplete(childKey))
+            return false;
+    }
+    return true;
+}
+
+bool AnalysisCache::restoreKey(const std::string &key, const std::string &dir) const {
+    auto entry = entryDir(key);
+
+    std::string creates;
+    if(!readWhole(entry + "/" + CREATES_FILE, creates))
+        return false;
+
+    mkdir(dir.c_str(), S_IRWXU);
+    for(auto& f : listFiles(entry)) {
+        if(f == BYTECODE_FILE || f == CREATES_FILE)
+            continue;
+
+        std::string contents;
+        if(!readWhole(entry + "/" + f, contents) || !writeWhole(dir + "/" + f, contents))
+            return false;
+    }
+
+    std::stringstream ss(creates);
+    std::string childKey;
+    size_t i = 0;
+    while(ss >> childKey) {
+        if(!restoreKey(childKey, dir + "/creates." + std::to_string(i++)))
+            return false;
+    }
+    return true;
+}
+
+bool AnalysisCache::CanRestore(const std::vector<uint8_t> &byteCode) const {
+    return Has(byteCode) && isComplete(Key(byteCode));
+}
+
+bool AnalysisCache::Restore(const std::vector<uint8_t> &byteCode, const std::string &dir) const {
+    // Checked up front so a missing child never leaves dir half written
+    if(!CanRestore(byteCode))
+        return false;
+    return restoreKey(Key(byteCode), dir);
+}
+
+void AnalysisCache::Store(const std::vector<uint8_t> &byteCode, const std::string &dir,
+                          const std::vector<std::string> &files,
+                          const std::vector<std::vector<uint8_t>> &createdByteCodes) const {
+    static std::atomic<size_t> tmpCounter(0);
+
+    auto key = Key(byteCode);
+    if(Has(byteCode))
+        return;
+
+    auto tmp = root + "/.tmp." + std::to_string(getpid()) + "." + std::to_string(tmpCounter++);
+    if(mkdir(tmp.c_str(), S_IRWXU) != 0)
+        return;
+
+    bool ok = writeWhole(tmp + "/" + BYTECODE_FILE, std::string(byteCode.begin(), byteCode.end()));
+
+    std::string creates;
+    for(auto& cc : createdByteCodes)
+        creates += Key(cc) + "\n";
+    ok = ok && writeWhole(tmp + "/" + CREATES_FILE, creates);
+
+    for(auto& f : files) {
+        std::string contents;
+        ok = ok && readWhole(dir + "/" + f, contents) && writeWhole(tmp + "/" + f, contents);
+    }
+
+    // Losing the race to another writer is fine; its entry is identical
+    if(!ok || rename(tmp.c_str(), entryDir(key).c_str()) != 0)
+        removeFlatDir(tmp);
+}
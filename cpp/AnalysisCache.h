@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Part of every cache key; bump it whenever a change alters analysis results
+// or report output so stale entries are never served.
+static const char* const ANALYZER_VERSION = "etheraudit-23";
+
+/***
+ * Persistent on-disk cache of finished contract reports, keyed by a hash of
+ * the bytecode, ANALYZER_VERSION and a salt naming any analysis options. Each entry is a directory holding the
+ * bytecode (checked on every lookup, so hash collisions are harmless), the
+ * report files createOutDir wrote, and the keys of any created contracts.
+ *
+ * Entries are published with an atomic rename, so many threads or processes
+ * can share one cache.
+ */
+class AnalysisCache {
+    std::string root, salt;
+
+    std::string entryDir(const std::string& key) const;
+    // True if key's entry, and those of every contract it creates, are there
+    bool isComplete(const std::string& key) const;
+    bool restoreKey(const std::string& key, const std::string& dir) const;
+public:
+    explicit AnalysisCache(const std::string& root, const std::string& salt = "");
+
+    std::string Key(const std::vector<uint8_t>& byteCode) const;
+
+    bool Has(const std::vector<uint8_t>& byteCode) const;
+    // Has byteCode, and every contract it creates down the line; what
+    // Restore needs to succeed
+    bool CanRestore(const std::vector<uint8_t>& byteCode) const;
+
+    // Writes the cached reports for byteCode, and those of its created
+    // contracts, into dir. Returns false on a miss.
+    bool Restore(const std::vector<uint8_t>& byteCode, const std::string& dir) const;
+
+    // Stores the named report files from dir. Created contracts must already
+    // be in the cache.
+    void Store(const std::vector<uint8_t>& byteCode, const std::string& dir, const std::vector<std::string>& files,
+               const std::vector<std::vector<uint8_t>>& createdByteCodes) const;
+};
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include "AuditEngine.h"
+
+// Calls are always counted; the clock is only read when timing
+template <typename Call>
+static inline void timed(AuditDetectorStats& stats, bool isTimed, const Call& call) {
+    stats.calls++;
+    if(!isTimed) {
+        call();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    call();
+    stats.time += std::chrono::steady_clock::now() - start;
+}
+
+// Over blocks, or every reachable block if null
+static AuditReport runAudit(const Program &program, const AuditRegistry &registry, const std::vector<uint32_t>* blocks,
+                            bool isTimed) {
+    AuditReport report;
+    std::vector<std::unique_ptr<AuditDetector>> detectors;
+    std::vector<AuditResults> found;
+    // Detectors taking part, and which of them want each opcode and blocks
+    std::vector<uint32_t> active, byBlock;
+    std::vector<uint32_t> byOpCode[256];
+
+    for(auto& factory : registry.Factories()) {
+        auto d = (uint32_t)detectors.size();
+        detectors.push_back(factory());
+        report.stats.emplace_back();
+        report.stats.back().name = detectors.back()->Name();
+
+        bool isWanted = false;
+        timed(report.stats[d], isTimed, [&] { isWanted = detectors[d]->Begin(program); });
+        if(!isWanted)
+            continue;
+
+        auto subscriptions = detectors[d]->Subscribe();
+        for(size_t op = 0;op < subscriptions.opCodes.size();op++) {
+            if(subscriptions.opCodes[op])
+                byOpCode[op].push_back(d);
+        }
+        if(subscriptions.blocks)
+            byBlock.push_back(d);
+        active.push_back(d);
+    }
+    found.resize(detectors.size());
+
+    auto& graph = program.Graph();
+    auto& store = program.Store();
+    auto visit = [&](const CFNode& node) {
+        for(auto d : byBlock)
+            timed(report.stats[d], isTimed, [&] { detectors[d]->OnBlock(node, found[d]); });
+
+        for(size_t i = node.first;i < node.last;i++) {
+            auto& listeners = byOpCode[store.OpCodeAt(i).opCode];
+            if(listeners.empty())
+                continue;
+            auto instruction = program.Instruction(i);
+            for(auto d : listeners)
+                timed(report.stats[d], isTimed, [&] { detectors[d]->OnInstruction(instruction, found[d]); });
+        }
+    };
+    if(blocks) {
+        for(auto b : *blocks)
+            visit(graph[b]);
+    } else {
+        for(auto& node : graph) {
+            if(graph.IsReachable(node.idx))
+                visit(node);
+        }
+    }
+
+    for(auto d : active)
+        timed(report.stats[d], isTimed, [&] { detectors[d]->End(found[d]); });
+
+    for(size_t d = 0;d < detectors.size();d++) {
+        report.stats[d].findings = found[d].size();
+        report.results.insert(report.results.end(), found[d].begin(), found[d].end());
+    }
+    std::stable_sort(report.results.begin(), report.results.end(), [](const AuditResult& a, const AuditResult& b) {
+        return a.Offset() < b.Offset();
+    });
+    return report;
+}
+
+AuditReport RunAudit(const Program &program, const AuditRegistry &registry, bool isTimed) {
+    return runAudit(program, registry, nullptr, isTimed);
+}
+
+AuditReport RunAudit(const Program &program, const FunctionTable::Function &function, const AuditRegistry &registry,
+                     bool isTimed) {
+    return runAudit(program, registry, &function.blocks, isTimed);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <bitset>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AuditResult.h"
+#include "FunctionTable.h"
+
+/***
+ * One check run by the AuditEngine. Subscribe says which opcodes (and
+ * whether whole blocks) it wants to see; it is handed just those during a
+ * single pass over the reachable blocks that every detector shares, so a
+ * detector that matches nothing costs next to nothing.
+ *
+ * A new detector is made for each program, so it may keep whatever it
+ * likes between calls.
+ */
+class AuditDetector {
+public:
+    struct Subscriptions {
+        std::bitset<256> opCodes;
+        bool blocks = false;
+
+        Subscriptions& OpCode(uint8_t opCode) { opCodes.set(opCode); return *this; }
+        Subscriptions& Blocks() { blocks = true; return *this; }
+    };
+
+    virtual ~AuditDetector() = default;
+
+    virtual const char* Name() const = 0;
+    virtual Subscriptions Subscribe() const = 0;
+
+    // Before the pass; returning false leaves this program out
+    virtual bool Begin(const Program&) { return true; }
+    // Called for a block before any of its instructions
+    virtual void OnBlock(const CFNode&, AuditResults&) {}
+    virtual void OnInstruction(const CFInstruction&, AuditResults&) {}
+    // After the pass, for whatever needs all of it
+    virtual void End(AuditResults&) {}
+};
+
+typedef std::function<std::unique_ptr<AuditDetector>()> AuditDetectorFactory;
+
+/***
+ * The detectors an audit runs, in the order they are registered.
+ * Default() holds the ones AuditForEverything uses.
+ */
+class AuditRegistry {
+    std::vector<AuditDetectorFactory> factories;
+public:
+    static AuditRegistry& Default();
+
+    void Register(AuditDetectorFactory factory) { factories.push_back(std::move(factory)); }
+    const std::vector<AuditDetectorFactory>& Factories() const { return factories; }
+};
+
+struct AuditDetectorStats {
+    std::string name;
+    // Calls made into the detector, Begin and End included
+    size_t calls = 0;
+    // Spent in those calls; only measured when the audit is timed
+    std::chrono::nanoseconds time{0};
+    size_t findings = 0;
+};
+
+struct AuditReport {
+    // Sorted by offset
+    AuditResults results;
+    // One per detector, in registry order; left out programs have 1 call
+    std::vector<AuditDetectorStats> stats;
+};
+
+// isTimed reads the clock around every detector call, for AuditDetectorStats
+AuditReport RunAudit(const Program& program, const AuditRegistry& registry = AuditRegistry::Default(),
+                     bool isTimed = false);
+// Audits one function's slice, so it can be redone or timed on its own.
+// Detectors still get the whole program in Begin; they see only the
+// slice's blocks and instructions.
+AuditReport RunAudit(const Program& program, const FunctionTable::Function& function,
+                     const AuditRegistry& registry = AuditRegistry::Default(), bool isTimed = false);
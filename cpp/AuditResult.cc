@@ -1,40 +1,370 @@
 
+#include <algorithm>
 #include "CFInstruction.h"
 #include "AuditResult.h"
+#include "AuditEngine.h"
 
-AuditResults AuditForUncheckedExternalCall(const Program &program) {
-    AuditResults rtn;
-    return rtn;
-}
+namespace {
+    // A source of taint reaching one kind of sink, as TaintAnalysis lists
+    // them. Not an issue in ctor contracts, which set their owner and such.
+    class TaintedSinkDetector : public AuditDetector {
+        const Program* program = nullptr;
+        TaintAnalysis::SinkKind kind;
+        TaintAnalysis::Taint source;
+    protected:
+        TaintedSinkDetector(TaintAnalysis::SinkKind kind, TaintAnalysis::Taint source) : kind(kind), source(source) {}
+        virtual const AuditClass& Finding() const = 0;
+    public:
+        Subscriptions Subscribe() const override {
+            Subscriptions subscriptions;
+            for(auto& sink : TaintAnalysis::Sinks()) {
+                if(sink.kind == kind)
+                    subscriptions.OpCode(sink.opCode);
+            }
+            return subscriptions;
+        }
 
+        bool Begin(const Program& p) override {
+            program = &p;
+            return p.createdContracts.empty();
+        }
 
-AuditResults AuditForOriginRead(const Program &program) {
-    static AuditClass OriginRead(1, "Contract is checking tx.origin instead of tx.sender");
+        void OnInstruction(const CFInstruction& instr, AuditResults& results) override {
+            if(program->Taint().OfSink(instr.index, instr.opCode.opCode, kind) & source)
+                results.emplace_back(instr.offset, Finding());
+        }
+    };
 
-    AuditResults rtn;
+    // tx.origin deciding a branch, which is how it ends up standing in for
+    // msg.sender in an access check
+    class OriginReadDetector : public TaintedSinkDetector {
+    public:
+        OriginReadDetector() : TaintedSinkDetector(TaintAnalysis::BRANCH_CONDITION, TaintAnalysis::ORIGIN) {}
+        const char* Name() const override { return "origin-read"; }
+        const AuditClass& Finding() const override {
+            static AuditClass OriginRead(1, "Contract is checking tx.origin instead of tx.sender");
+            return OriginRead;
+        }
+    };
 
-    // Not an issue at all in ctor contracts
-    if(!program.createdContracts.empty())
-        return rtn;
+    // msg.sender written to storage as a value, as in owner = msg.sender.
+    // Keys are fine: that is every balances[msg.sender].
+    class MsgSenderSaveDetector : public TaintedSinkDetector {
+    public:
+        MsgSenderSaveDetector() : TaintedSinkDetector(TaintAnalysis::STORED_VALUE, TaintAnalysis::CALLER) {}
+        const char* Name() const override { return "msg-sender-save"; }
+        const AuditClass& Finding() const override {
+            static AuditClass MsgSenderSave(1, "Contract saves msg.sender to storage outside its constructor");
+            return MsgSenderSave;
+        }
+    };
 
-    for(auto i : program.Instructions()) {
-        if(auto instr = i.second) {
-           if(instr->opCode.opCode == OpCodes::OP_ORIGIN &&
-                   program.GetNode(*instr)->IsReachable()) {
-               rtn.emplace_back(i.first, OriginRead);
-           }
+    // Gas a call can forward and still not be reentered: the stipend a
+    // value transfer gets
+    const int64_t CALL_STIPEND = 2300;
+
+    // Whether v is known to be at most limit. Follows phis and the
+    // ISZERO(x) * 2300 that send and transfer compile to, a few levels deep.
+    bool isAtMost(const Program& program, SSAForm::Value v, int64_t limit, size_t depth = 4) {
+        auto& ssa = program.SSA();
+        if(depth == 0 || v == SSAForm::NONE)
+            return false;
+
+        int64_t value = 0;
+        switch(ssa.KindOf(v)) {
+            case SSAForm::CONSTANT:
+                return program.Expressions().GetConstantInt(ssa.Expression(v), &value) && value >= 0 && value <= limit;
+            case SSAForm::PHI:
+                for(auto in : ssa.Incoming(v)) {
+                    if(!isAtMost(program, in, limit, depth - 1))
+                        return false;
+                }
+                return true;
+            case SSAForm::OUTPUT:
+                break;
+            default:
+                return false;
+        }
+
+        auto i = ssa.DefinedAt(v);
+        auto operands = ssa.Operands(i);
+        switch(program.Store().OpCodeAt(i).opCode) {
+            case OpCodes::OP_ISZERO:
+            case OpCodes::OP_LT:
+            case OpCodes::OP_GT:
+            case OpCodes::OP_SLT:
+            case OpCodes::OP_SGT:
+            case OpCodes::OP_EQ:
+                return limit >= 1;
+            case OpCodes::OP_MUL:
+                return (isAtMost(program, operands[0], 1, depth - 1) && isAtMost(program, operands[1], limit, depth - 1)) ||
+                       (isAtMost(program, operands[1], 1, depth - 1) && isAtMost(program, operands[0], limit, depth - 1));
+            case OpCodes::OP_AND:
+                return isAtMost(program, operands[0], limit, depth - 1) || isAtMost(program, operands[1], limit, depth - 1);
+            default:
+                return false;
         }
     }
 
-    return rtn;
+    // Address 1 to 8: built in contracts, such as the identity contract
+    // old compilers copy memory with
+    bool isPrecompile(const Program& program, SSAForm::Value address) {
+        auto& ssa = program.SSA();
+        int64_t value = 0;
+        return ssa.KindOf(address) == SSAForm::CONSTANT &&
+               program.Expressions().GetConstantInt(ssa.Expression(address), &value) &&
+               value >= 1 && value <= 8;
+    }
+
+    /***
+     * Storage written after a call that hands the callee enough gas to call
+     * back in. Which forwarding calls have been made on some path into each
+     * block is a forward bitvector problem, one bit per call: an entry is
+     * the union of its predecessors' exits and nothing is ever cleared. It
+     * is solved over the program's ContextGraph rather than its blocks, so
+     * a call made before one caller of a shared internal function does not
+     * come out at the other callers' return sites. The pass collects the
+     * calls and stores; End solves it with a worklist, touching each node at
+     * most once per bit that grows.
+     */
+    class ExternalCallBeforeStateChangeDetector : public AuditDetector {
+        const Program* program = nullptr;
+        // Forwarding calls seen, per block, in order
+        std::vector<std::pair<uint32_t, uint32_t>> calls;
+        struct Store {
+            size_t offset;
+            uint32_t block;
+            // After a forwarding call in the same block
+            bool isAfterCall;
+        };
+        std::vector<Store> stores;
+        size_t block = 0;
+        bool isAfterCall = false;
+
+        bool forwardsGas(const CFInstruction& instr) const {
+            auto operands = program->SSA().Operands(instr.index);
+            // Precompiles never call back
+            return !isAtMost(*program, operands[0], CALL_STIPEND) && !isPrecompile(*program, operands[1]);
+        }
+    public:
+        const char* Name() const override { return "external-call-before-state-change"; }
+        Subscriptions Subscribe() const override {
+            return Subscriptions().Blocks()
+                    .OpCode(OpCodes::OP_CALL).OpCode(OpCodes::OP_CALLCODE).OpCode(OpCodes::OP_DELEGATECALL)
+                    .OpCode(OpCodes::OP_SSTORE);
+        }
+
+        bool Begin(const Program& p) override {
+            program = &p;
+            // Nothing can call into a contract while it is being created
+            return p.createdContracts.empty();
+        }
+
+        void OnBlock(const CFNode& node, AuditResults&) override {
+            block = node.idx;
+            isAfterCall = false;
+        }
+
+        void OnInstruction(const CFInstruction& instr, AuditResults&) override {
+            if(instr.opCode.opCode == OpCodes::OP_SSTORE) {
+                stores.push_back({ instr.offset, (uint32_t)block, isAfterCall });
+            } else if(forwardsGas(instr)) {
+                calls.emplace_back((uint32_t)block, (uint32_t)calls.size());
+                isAfterCall = true;
+            }
+        }
+
+        void End(AuditResults& results) override {
+            static AuditClass StateChangeAfterCall(2, "State is changed after an external call that forwards gas (reentrancy)");
+            if(calls.empty() || stores.empty())
+                return;
+
+            auto& graph = program->Graph();
+            auto& contexts = program->Contexts();
+            auto words = (calls.size() + 63) / 64;
+            // Bits of the calls made on some path to the start of each
+            // context node, and of those made in each block
+            std::vector<uint64_t> in(contexts.Size() * words), gen(graph.Size() * words);
+            std::vector<uint32_t> work;
+            std::vector<bool> isQueued(contexts.Size());
+            for(auto& call : calls) {
+                gen[call.first * words + call.second / 64] |= 1ull << (call.second % 64);
+                for(auto n = contexts.Begin(call.first);n < contexts.End(call.first);n++) {
+                    if(!isQueued[n]) {
+                        isQueued[n] = true;
+                        work.push_back((uint32_t)n);
+                    }
+                }
+            }
+
+            std::vector<uint64_t> out(words);
+            while(!work.empty()) {
+                auto n = work.back();
+                work.pop_back();
+                isQueued[n] = false;
+                auto b = contexts[n].block;
+                for(size_t w = 0;w < words;w++)
+                    out[w] = in[n * words + w] | gen[b * words + w];
+
+                for(auto next : contexts[n].next) {
+                    bool isChanged = false;
+                    for(size_t w = 0;w < words;w++) {
+                        auto& word = in[next * words + w];
+                        isChanged |= (out[w] & ~word) != 0;
+                        word |= out[w];
+                    }
+                    if(isChanged && !isQueued[next]) {
+                        isQueued[next] = true;
+                        work.push_back(next);
+                    }
+                }
+            }
+
+            for(auto& store : stores) {
+                auto first = in.begin() + contexts.Begin(store.block) * words;
+                auto last = in.begin() + contexts.End(store.block) * words;
+                if(store.isAfterCall || std::any_of(first, last, [](uint64_t w) { return w != 0; }))
+                    results.emplace_back(store.offset, StateChangeAfterCall);
+            }
+        }
+    };
+
+    // Ops a call's success flag goes through on its way to a branch
+    bool passesCondition(uint8_t opCode) {
+        switch(opCode) {
+            case OpCodes::OP_ISZERO:
+            case OpCodes::OP_NOT:
+            case OpCodes::OP_EQ:
+            case OpCodes::OP_LT:
+            case OpCodes::OP_GT:
+            case OpCodes::OP_SLT:
+            case OpCodes::OP_SGT:
+            case OpCodes::OP_AND:
+            case OpCodes::OP_OR:
+            case OpCodes::OP_XOR:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /***
+     * A call whose success flag never decides a branch. From the flag the
+     * SSA uses are followed through phis and the comparisons and bit ops
+     * above until one is a JUMPI condition. Each value is looked at once
+     * per call, so a call costs its flag's uses.
+     */
+    class UncheckedExternalCallDetector : public AuditDetector {
+        const Program* program = nullptr;
+        // Values seen for the call being looked at; stamped with its number
+        // so the array is never cleared
+        std::vector<uint32_t> seenBy;
+        uint32_t stamp = 0;
+        std::vector<SSAForm::Value> work;
+
+        bool isChecked(SSAForm::Value flag) {
+            auto& ssa = program->SSA();
+            auto& store = program->Store();
+            stamp++;
+            work.assign(1, flag);
+            seenBy[flag] = stamp;
+
+            auto visit = [&](SSAForm::Value v) {
+                if(v != SSAForm::NONE && seenBy[v] != stamp) {
+                    seenBy[v] = stamp;
+                    work.push_back(v);
+                }
+            };
+            while(!work.empty()) {
+                auto v = work.back();
+                work.pop_back();
+                for(auto& use : ssa.Uses(v)) {
+                    if(use.isPhi) {
+                        visit(use.user);
+                        continue;
+                    }
+                    auto opCode = store.OpCodeAt(use.user).opCode;
+                    if(opCode == OpCodes::OP_JUMPI && use.operand == 1)
+                        return true;
+                    if(!passesCondition(opCode))
+                        continue;
+                    auto outputs = store.Outputs(use.user);
+                    if(!outputs.empty() && outputs[0].isSymbolic())
+                        visit(ssa.OfSymbol(outputs[0].idx()));
+                }
+            }
+            return false;
+        }
+    public:
+        const char* Name() const override { return "unchecked-external-call"; }
+        Subscriptions Subscribe() const override {
+            return Subscriptions().OpCode(OpCodes::OP_CALL).OpCode(OpCodes::OP_CALLCODE).OpCode(OpCodes::OP_DELEGATECALL);
+        }
+
+        bool Begin(const Program& p) override {
+            program = &p;
+            seenBy.assign(p.SSA().Size(), 0);
+            return true;
+        }
+
+        void OnInstruction(const CFInstruction& instr, AuditResults& results) override {
+            static AuditClass UncheckedCall(2, "Result of an external call is never checked");
+            // Nothing to check: a precompile only fails when out of gas
+            if(isPrecompile(*program, program->SSA().Operands(instr.index)[1]))
+                return;
+            auto flag = instr.outputs[0].isSymbolic() ? program->SSA().OfSymbol(instr.outputs[0].idx()) : SSAForm::NONE;
+            if(flag == SSAForm::NONE || !isChecked(flag))
+                results.emplace_back(instr.offset, UncheckedCall);
+        }
+    };
+
+    template <typename T>
+    void registerDetector(AuditRegistry& registry) {
+        registry.Register([] { return std::unique_ptr<AuditDetector>(new T()); });
+    }
+
+    // Runs a single detector on its own
+    template <typename T>
+    AuditResults runDetector(const Program& program) {
+        AuditRegistry registry;
+        registerDetector<T>(registry);
+        return RunAudit(program, registry).results;
+    }
+}
+
+AuditRegistry& AuditRegistry::Default() {
+    static AuditRegistry registry = [] {
+        AuditRegistry builtIn;
+        registerDetector<OriginReadDetector>(builtIn);
+        registerDetector<MsgSenderSaveDetector>(builtIn);
+        registerDetector<ExternalCallBeforeStateChangeDetector>(builtIn);
+        registerDetector<UncheckedExternalCallDetector>(builtIn);
+        return builtIn;
+    }();
+    return registry;
+}
+
+AuditResults AuditForUncheckedExternalCall(const Program &program) {
+    return runDetector<UncheckedExternalCallDetector>(program);
+}
+
+AuditResults AuditForOriginRead(const Program &program) {
+    return runDetector<OriginReadDetector>(program);
+}
+
+AuditResults AuditForMsgSenderSave(const Program &program) {
+    return runDetector<MsgSenderSaveDetector>(program);
+}
+
+AuditResults AuditForExternalCallBeforeStateChange(const Program &program) {
+    return runDetector<ExternalCallBeforeStateChangeDetector>(program);
 }
 
 
 AuditResults AuditForEverything(const Program &program) {
-    AuditResults rtn = AuditForOriginRead(program);
-    return rtn;
+    return RunAudit(program).results;
 }
 
-AuditResult::AuditResult(size_t offset, const AuditClass &type) : offset(offset), type(type) {}
+AuditResult::AuditResult(size_t offset, const AuditClass &type) : offset(offset), type(&type) {}
 
 AuditClass::AuditClass(size_t severity, const std::string &message) : severity(severity), message(message) {}
@@ -18,11 +18,12 @@ public:
 
 class AuditResult {
     size_t offset;
-    const AuditClass& type;
+    // A pointer so results can be sorted
+    const AuditClass* type;
 
 public:
     size_t Offset() const { return offset; }
-    const AuditClass& Type() const { return type; }
+    const AuditClass& Type() const { return *type; }
     AuditResult(size_t offset, const AuditClass &type);
 };
 
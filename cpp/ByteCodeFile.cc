@@ -0,0 +1,211 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cctype>
+
+#include "ByteCodeFile.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+MappedFile::MappedFile(const std::string &fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+
+    struct stat st = {};
+    if(fstat(fd, &st) == 0) {
+        size = static_cast<size_t>(st.st_size);
+        if(size == 0) {
+            isOpen = true;
+        } else {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapped != MAP_FAILED) {
+                madvise(mapped, size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(mapped);
+                isOpen = true;
+            } else {
+                size = 0;
+            }
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if(data)
+        munmap(const_cast<char*>(data), size);
+}
+
+static const uint8_t INVALID_NIBBLE = 0xff;
+
+struct NibbleTable {
+    uint8_t values[256];
+
+    NibbleTable() {
+        for(auto& v : values)
+            v = INVALID_NIBBLE;
+        for(int i = 0;i < 10;i++)
+            values['0' + i] = i;
+        for(int i = 0;i < 6;i++) {
+            values['a' + i] = 10 + i;
+            values['A' + i] = 10 + i;
+        }
+    }
+};
+
+static const NibbleTable nibbles;
+
+// Returns the number of bytes written; stops early on the first bad digit
+static size_t decodeScalar(const char* in, size_t count, uint8_t* out) {
+    for(size_t i = 0;i < count;i++) {
+        uint8_t hi = nibbles.values[(uint8_t)in[2 * i]];
+        uint8_t lo = nibbles.values[(uint8_t)in[2 * i + 1]];
+        if((hi | lo) & 0xf0)
+            return i;
+        out[i] = (hi << 4) | lo;
+    }
+    return count;
+}
+
+#ifdef HAS_X86_KERNELS
+/***
+ * The vector kernels map every character to its nibble value with two range
+ * checks ('0'-'9' and case folded 'a'-'f'), then fold adjacent nibble pairs
+ * in 16 bit lanes and narrow them back down to bytes. A block holding any bad
+ * character is left for the scalar loop, which finds and reports it.
+ */
+static inline __m128i nibblesSSE2(__m128i c, int* valid) {
+    const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+    *valid = _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) == 0xffff;
+    return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                        _mm_and_si128(isAlpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+static inline __m128i pairsSSE2(__m128i n) {
+    // Lane i holds (lo << 8) | hi; rebuild (hi << 4) | lo in the low byte
+    const __m128i hi = _mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00ff)), 4);
+    const __m128i lo = _mm_srli_epi16(n, 8);
+    return _mm_or_si128(hi, lo);
+}
+
+static size_t decodeSSE2(const char* in, size_t count, uint8_t* out) {
+    size_t i = 0;
+    for(;i + 16 <= count;i += 16) {
+        int validA = 0, validB = 0;
+        __m128i a = nibblesSSE2(_mm_loadu_si128((const __m128i*)(in + 2 * i)), &validA);
+        __m128i b = nibblesSSE2(_mm_loadu_si128((const __m128i*)(in + 2 * i + 16)), &validB);
+        if(!validA || !validB)
+            break;
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(pairsSSE2(a), pairsSSE2(b)));
+    }
+    return i + decodeScalar(in + 2 * i, count - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i nibblesAVX2(__m256i c, int* valid) {
+    const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    const __m256i isAlpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+
+    *valid = _mm256_movemask_epi8(_mm256_or_si256(isDigit, isAlpha)) == -1;
+    return _mm256_or_si256(_mm256_and_si256(isDigit, digit),
+                           _mm256_and_si256(isAlpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pairsAVX2(__m256i n) {
+    const __m256i hi = _mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0x00ff)), 4);
+    const __m256i lo = _mm256_srli_epi16(n, 8);
+    return _mm256_or_si256(hi, lo);
+}
+
+__attribute__((target("avx2")))
+static size_t decodeAVX2(const char* in, size_t count, uint8_t* out) {
+    size_t i = 0;
+    for(;i + 32 <= count;i += 32) {
+        int validA = 0, validB = 0;
+        __m256i a = nibblesAVX2(_mm256_loadu_si256((const __m256i*)(in + 2 * i)), &validA);
+        __m256i b = nibblesAVX2(_mm256_loadu_si256((const __m256i*)(in + 2 * i + 32)), &validB);
+        if(!validA || !validB)
+            break;
+        // packus works per 128 bit lane, so put the quarters back in order
+        __m256i packed = _mm256_packus_epi16(pairsAVX2(a), pairsAVX2(b));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return i + decodeSSE2(in + 2 * i, count - i, out + i);
+}
+#endif
+
+typedef size_t (*DecodeKernel)(const char* in, size_t count, uint8_t* out);
+
+static DecodeKernel selectKernel() {
+#ifdef HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return decodeAVX2;
+    return decodeSSE2;
+#else
+    return decodeScalar;
+#endif
+}
+
+bool parseByteCode(const char *text, size_t length, std::vector<uint8_t> &byteCode, std::string *error) {
+    static const DecodeKernel decode = selectKernel();
+
+    const char* begin = text;
+    const char* end = text + length;
+    while(begin < end && isspace((uint8_t)*begin))
+        begin++;
+    if(end - begin >= 2 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X'))
+        begin += 2;
+
+    // Most inputs are one unbroken line, so decode them straight from the
+    // source; only copy when there is whitespace to squeeze out.
+    std::string compacted;
+    for(const char* c = begin;c < end;c++) {
+        if(isspace((uint8_t)*c)) {
+            compacted.reserve(end - begin);
+            compacted.assign(begin, c);
+            for(;c < end;c++) {
+                if(!isspace((uint8_t)*c))
+                    compacted.push_back(*c);
+            }
+            begin = compacted.data();
+            end = begin + compacted.size();
+            break;
+        }
+    }
+
+    size_t digits = end - begin;
+    if(digits % 2) {
+        if(error)
+            *error = "odd number of hex digits (" + std::to_string(digits) + ")";
+        return false;
+    }
+
+    byteCode.resize(digits / 2);
+    size_t decoded = decode(begin, byteCode.size(), byteCode.data());
+    if(decoded != byteCode.size()) {
+        const char* bad = begin + 2 * decoded;
+        if(nibbles.values[(uint8_t)*bad] != INVALID_NIBBLE)
+            bad++;
+        if(error)
+            *error = std::string("invalid hex character '") + *bad + "' at digit " + std::to_string(bad - begin);
+        byteCode.clear();
+        return false;
+    }
+    return true;
+}
+
+bool parseByteCode(const std::string &text, std::vector<uint8_t> &byteCode, std::string *error) {
+    return parseByteCode(text.data(), text.size(), byteCode, error);
+}
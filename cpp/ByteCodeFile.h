@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/***
+ * Read only view of a whole file mapped into memory.
+ */
+class MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool isOpen = false;
+public:
+    explicit MappedFile(const std::string& fileName);
+    ~MappedFile();
+
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(const MappedFile&) = delete;
+
+    bool IsOpen() const { return isOpen; }
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+};
+
+/***
+ * Decodes hex text into bytes. A leading '0x' and whitespace anywhere in the
+ * text are ignored. Returns false, and describes why in error, if the text
+ * holds a non hex character or an odd number of digits.
+ */
+bool parseByteCode(const char* text, size_t length, std::vector<uint8_t>& byteCode, std::string* error = nullptr);
+
+bool parseByteCode(const std::string& text, std::vector<uint8_t>& byteCode, std::string* error = nullptr);
@@ -1,76 +1,205 @@
-
-
-#include "Program.h"
-#include <iostream>
-#include <set>
+#include <assert.h>
+#include <algorithm>
 #include "CFExpression.h"
 #include "Utils.h"
 
-bool CFExpression::getConstantInt(int64_t *v) {
-    if(!isConstant)
-        return false;
-
-    return getInt64FromVec(constantValue, v);
+CFExpression::CFExpression(Kind kind, size_t payload) {
+    assert(payload <= PAYLOAD_MASK);
+    handle = ((uint32_t)kind << KIND_SHIFT) | (uint32_t)payload;
 }
 
-std::ostream &operator<<(std::ostream &os, const CFExpression &entry) {
-    if(entry.isConstant) {
-        os << "{" << toString(entry.constantValue) << "}";
-    } else {
+size_t CFStackHash::operator()(const CFStack &stack) const {
+    // FNV-1a over the handles
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(auto& e : stack) {
+        hash ^= e.handle;
+        hash *= 0x100000001b3ull;
+    }
+    return (size_t)hash;
+}
 
-        if(!entry.label.empty()) {
-            os << "<" << entry.label << ".";
-        } else {
-            os << "<#";
-        }
-        os << std::dec << entry.idx << ">";
+size_t ExpressionArena::ConstantHash::operator()(const ConstantEntry &c) const {
+    uint64_t hash = c.length;
+    for(auto limb : c.value.limbs) {
+        hash ^= limb + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
     }
-    return os;
+    return (size_t)hash;
 }
 
-bool CFExpression::operator==(const CFExpression &rhs) const {
-    return idx == rhs.idx &&
-           label == rhs.label &&
-           isConstant == rhs.isConstant &&
-           constantValue == rhs.constantValue;
+ExpressionArena::ExpressionArena(const ExpressionArena *base) : base(base) {
+    if(base) {
+        baseConstants = base->Size();
+        baseSets = base->SetCount();
+    }
 }
 
-bool CFExpression::operator!=(const CFExpression &rhs) const {
-    return !(rhs == *this);
+const ExpressionArena::ConstantEntry &ExpressionArena::entry(size_t id) const {
+    return id < baseConstants ? base->entry(id) : constants[id - baseConstants];
 }
 
-bool CFExpression::operator<(const CFExpression &rhs) const {
-    if (idx < rhs.idx)
-        return true;
-    if (rhs.idx < idx)
-        return false;
-    if (label < rhs.label)
+bool ExpressionArena::findConstant(const ConstantEntry &c, uint32_t &id) const {
+    if(base && base->findConstant(c, id))
         return true;
-    if (rhs.label < label)
+    auto it = interned.find(c);
+    if(it == interned.end())
         return false;
-    if (isConstant < rhs.isConstant)
+    id = it->second;
+    return true;
+}
+
+bool ExpressionArena::findSet(const CFStack &members, uint32_t &id) const {
+    if(base && base->findSet(members, id))
         return true;
-    if (rhs.isConstant < isConstant)
+    auto it = internedSets.find(members);
+    if(it == internedSets.end())
         return false;
-    return constantValue < rhs.constantValue;
+    id = it->second;
+    return true;
 }
 
-bool CFExpression::operator>(const CFExpression &rhs) const {
-    return rhs < *this;
+CFExpression ExpressionArena::Constant(const uint256 &value, size_t length) {
+    if(length == 0)
+        length = std::max<size_t>(value.ByteLength(), 1);
+
+    ConstantEntry c = { value, (uint8_t)std::min<size_t>(length, 32) };
+    uint32_t id = 0;
+    if(findConstant(c, id))
+        return CFExpression(CFExpression::CONSTANT, id);
+
+    id = (uint32_t)Size();
+    constants.push_back(c);
+    interned.emplace(c, id);
+    return CFExpression(CFExpression::CONSTANT, id);
 }
 
-bool CFExpression::operator<=(const CFExpression &rhs) const {
-    return !(rhs < *this);
+const uint256 &ExpressionArena::Value(CFExpression e) const {
+    assert(e.isConstant());
+    return entry(e.payload()).value;
 }
 
-bool CFExpression::operator>=(const CFExpression &rhs) const {
-    return !(*this < rhs);
+size_t ExpressionArena::Length(CFExpression e) const {
+    assert(e.isConstant());
+    return entry(e.payload()).length;
 }
 
-bool CFExpression::isSymbolic() const {
-    if(isConstant)
+bool ExpressionArena::GetConstantInt(CFExpression e, int64_t *v) const {
+    if(!e.isConstant())
         return false;
-    if(!label.empty())
+
+    auto& value = Value(e);
+    if(!value.FitsUInt64())
         return false;
+    if(v)
+        *v = (int64_t)value.Low64();
     return true;
 }
+
+CFExpression ExpressionArena::ConstantSet(CFStack& members) {
+    std::sort(members.begin(), members.end());
+    members.erase(std::unique(members.begin(), members.end()), members.end());
+    assert(!members.empty());
+    if(members.size() == 1)
+        return members[0];
+
+    uint32_t id = 0;
+    if(findSet(members, id))
+        return CFExpression(CFExpression::CONSTANT_SET, id);
+
+    id = (uint32_t)SetCount();
+    setMembers.insert(setMembers.end(), members.begin(), members.end());
+    setsAt.push_back((uint32_t)setMembers.size());
+    internedSets.emplace(members, id);
+    return CFExpression(CFExpression::CONSTANT_SET, id);
+}
+
+CFStack::const_pointer ExpressionArena::MembersBegin(const CFExpression &e) const {
+    if(e.isConstant())
+        return &e;
+    assert(e.isConstantSet());
+    if(e.payload() < baseSets)
+        return base->MembersBegin(e);
+    return setMembers.data() + setsAt[e.payload() - baseSets];
+}
+
+size_t ExpressionArena::MemberCount(const CFExpression &e) const {
+    if(e.isConstant())
+        return 1;
+    assert(e.isConstantSet());
+    if(e.payload() < baseSets)
+        return base->MemberCount(e);
+    auto i = e.payload() - baseSets;
+    return setsAt[i + 1] - setsAt[i];
+}
+
+CFExpression ExpressionArena::Join(CFExpression a, CFExpression b, size_t maxSetSize) {
+    if(a == b)
+        return a;
+
+    bool aConstant = a.isConstant() || a.isConstantSet();
+    bool bConstant = b.isConstant() || b.isConstantSet();
+    if(!aConstant || !bConstant)
+        return CFExpression::Unknown();
+
+    auto& members = joinScratch;
+    members.assign(MembersBegin(a), MembersBegin(a) + MemberCount(a));
+    members.insert(members.end(), MembersBegin(b), MembersBegin(b) + MemberCount(b));
+    if(members.size() > maxSetSize) {
+        // Sets may overlap; only give up once the union really is too big
+        std::sort(members.begin(), members.end());
+        members.erase(std::unique(members.begin(), members.end()), members.end());
+        if(members.size() > maxSetSize)
+            return CFExpression::Unknown();
+    }
+    return ConstantSet(members);
+}
+
+CFExpression ExpressionArena::Import(const ExpressionArena &other, CFExpression e) {
+    // Handles other took from this arena as its base carry over as they are
+    if(other.base == this && ((e.isConstant() && e.payload() < other.baseConstants) ||
+                              (e.isConstantSet() && e.payload() < other.baseSets)))
+        return e;
+
+    if(e.isConstant())
+        return Constant(other.Value(e), other.Length(e));
+    if(!e.isConstantSet())
+        return e;
+
+    CFStack members;
+    for(size_t i = 0;i < other.MemberCount(e);i++)
+        members.push_back(Import(other, other.MembersBegin(e)[i]));
+    return ConstantSet(members);
+}
+
+std::ostream &ExpressionArena::Stream(std::ostream &os, CFExpression e) const {
+    switch(e.kind()) {
+        case CFExpression::CONSTANT: {
+            uint8_t bytes[32];
+            auto length = Length(e);
+            Value(e).ToBigEndian(bytes);
+            os << "{" << toString(bytes + 32 - length, length) << "}";
+            break;
+        }
+        case CFExpression::CONSTANT_SET: {
+            os << "{";
+            auto members = MembersBegin(e);
+            for(size_t i = 0;i < MemberCount(e);i++) {
+                uint8_t bytes[32];
+                auto length = Length(members[i]);
+                Value(members[i]).ToBigEndian(bytes);
+                os << (i ? " | " : "") << toString(bytes + 32 - length, length);
+            }
+            os << "}";
+            break;
+        }
+        case CFExpression::UNKNOWN:
+            os << "<?>";
+            break;
+        case CFExpression::ARGUMENT:
+            os << "<argument." << std::dec << e.idx() << ">";
+            break;
+        default:
+            os << "<#" << std::dec << e.idx() << ">";
+            break;
+    }
+    return os;
+}
@@ -1,28 +1,134 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <ostream>
+#include <unordered_map>
 #include <stdlib.h>
+#include <stdint.h>
+#include "uint256.h"
 
+/***
+ * A stack value as a 32 bit handle. The top three bits give the kind; the
+ * rest is the symbol or argument index, or for constants and constant sets
+ * an index into the owning program's ExpressionArena. Both are interned, so
+ * equal handles mean equal expressions and comparisons never look past the
+ * handle.
+ *
+ * Constant sets and UNKNOWN only come out of the stack solver's joins: a
+ * set is one of a few constants, UNKNOWN is anything at all.
+ */
 struct CFExpression {
-    size_t idx;
-    std::string label = "";
-    bool isConstant = false;
-    std::vector<uint8_t> constantValue;
+    enum Kind : uint32_t {
+        SYMBOL = 0,
+        ARGUMENT = 1,
+        CONSTANT = 2,
+        CONSTANT_SET = 3,
+        UNKNOWN = 4
+    };
+    static const uint32_t KIND_SHIFT = 29;
+    static const uint32_t PAYLOAD_MASK = (1u << KIND_SHIFT) - 1;
 
-    bool isSymbolic() const;
-    bool getConstantInt(int64_t* v);
+    uint32_t handle = 0;
 
-    friend std::ostream &operator<<(std::ostream &os, const CFExpression &entry);
+    CFExpression() = default;
+    CFExpression(Kind kind, size_t payload);
 
-    bool operator==(const CFExpression &rhs) const;
+    static CFExpression Symbol(size_t idx) { return CFExpression(SYMBOL, idx); }
+    static CFExpression Argument(size_t idx) { return CFExpression(ARGUMENT, idx); }
+    static CFExpression Unknown() { return CFExpression(UNKNOWN, 0); }
 
-    bool operator!=(const CFExpression &rhs) const;
+    Kind kind() const { return (Kind)(handle >> KIND_SHIFT); }
+    size_t payload() const { return handle & PAYLOAD_MASK; }
 
-    bool operator<(const CFExpression &rhs) const;
+    bool isConstant() const { return kind() == CONSTANT; }
+    bool isArgument() const { return kind() == ARGUMENT; }
+    bool isSymbolic() const { return kind() == SYMBOL; }
+    bool isConstantSet() const { return kind() == CONSTANT_SET; }
+    bool isUnknown() const { return kind() == UNKNOWN; }
 
-    bool operator>(const CFExpression &rhs) const;
+    // Symbol or argument number; meaningless for constants
+    size_t idx() const { return payload(); }
 
-    bool operator<=(const CFExpression &rhs) const;
+    bool operator==(const CFExpression &rhs) const { return handle == rhs.handle; }
+    bool operator!=(const CFExpression &rhs) const { return handle != rhs.handle; }
+    bool operator<(const CFExpression &rhs) const { return handle < rhs.handle; }
+    bool operator>(const CFExpression &rhs) const { return handle > rhs.handle; }
+    bool operator<=(const CFExpression &rhs) const { return handle <= rhs.handle; }
+    bool operator>=(const CFExpression &rhs) const { return handle >= rhs.handle; }
+};
 
-    bool operator>=(const CFExpression &rhs) const;
-};
\ No newline at end of file
+typedef std::vector<CFExpression> CFStack;
+
+struct CFStackHash {
+    size_t operator()(const CFStack& stack) const;
+};
+
+/***
+ * Interned constant values and constant sets for one program. Handing out
+ * the same handle for the same (value, printed width), or the same members,
+ * is what makes CFExpression equality a single compare. Not thread safe;
+ * each Program owns its own.
+ *
+ * An arena can be layered over a base arena: it starts with every handle the
+ * base has, and only what it adds is stored in it. Several can share a base,
+ * which must not change while they are in use.
+ */
+class ExpressionArena {
+    struct ConstantEntry {
+        uint256 value;
+        uint8_t length;
+
+        bool operator==(const ConstantEntry& rhs) const { return length == rhs.length && value == rhs.value; }
+    };
+    struct ConstantHash {
+        size_t operator()(const ConstantEntry& c) const;
+    };
+
+    std::vector<ConstantEntry> constants;
+    std::unordered_map<ConstantEntry, uint32_t, ConstantHash> interned;
+
+    // Set i holds setMembers[setsAt[i] .. setsAt[i+1]), sorted by handle
+    std::vector<uint32_t> setsAt = { 0 };
+    std::vector<CFExpression> setMembers;
+    std::unordered_map<CFStack, uint32_t, CFStackHash> internedSets;
+    CFStack joinScratch;
+
+    const ExpressionArena* base = nullptr;
+    size_t baseConstants = 0, baseSets = 0;
+
+    const ConstantEntry& entry(size_t id) const;
+    bool findConstant(const ConstantEntry& c, uint32_t& id) const;
+    bool findSet(const CFStack& members, uint32_t& id) const;
+public:
+    explicit ExpressionArena(const ExpressionArena* base = nullptr);
+
+    // length is the number of bytes shown when printed; 0 picks the minimum
+    CFExpression Constant(const uint256& value, size_t length = 0);
+
+    const uint256& Value(CFExpression e) const;
+    size_t Length(CFExpression e) const;
+    // True only for constants that fit in 64 bits
+    bool GetConstantInt(CFExpression e, int64_t* v) const;
+
+    // Set of the given constants; members is sorted and deduplicated in
+    // place, and a single member gives back the constant itself
+    CFExpression ConstantSet(CFStack& members);
+    // Members of a constant set, or e itself for a constant. Points into e
+    // in that case, so e must outlive the result.
+    CFStack::const_pointer MembersBegin(const CFExpression& e) const;
+    size_t MemberCount(const CFExpression& e) const;
+
+    // Least upper bound of two stack values: equal values stay as they are,
+    // constants and sets union into a set of at most maxSetSize members,
+    // and anything else becomes UNKNOWN.
+    CFExpression Join(CFExpression a, CFExpression b, size_t maxSetSize);
+
+    // Same value in this arena as e has in other
+    CFExpression Import(const ExpressionArena& other, CFExpression e);
+
+    size_t Size() const { return baseConstants + constants.size(); }
+    size_t SetCount() const { return baseSets + setsAt.size() - 1; }
+
+    std::ostream& Stream(std::ostream& os, CFExpression e) const;
+};
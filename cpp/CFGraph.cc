@@ -0,0 +1,114 @@
+#include <assert.h>
+#include <algorithm>
+#include "CFGraph.h"
+
+CFNode &CFGraph::Add(CFNode node) {
+    assert(nodes.empty() || nodes.back().end <= node.start);
+    node.idx = nodes.size();
+    starts.push_back((uint32_t)node.start);
+    nodes.push_back(std::move(node));
+    return nodes.back();
+}
+
+bool CFGraph::AddEdge(size_t from, size_t to) {
+    assert(from < nodes.size() && to < nodes.size());
+    std::pair<uint32_t, uint32_t> edge((uint32_t)from, (uint32_t)to);
+
+    if(from + 1 < nextAt.size()) {
+        auto row = Next(from);
+        if(std::binary_search(row.begin(), row.end(), edge.second))
+            return false;
+    }
+    if(std::find(pendingEdges.begin(), pendingEdges.end(), edge) != pendingEdges.end())
+        return false;
+
+    pendingEdges.push_back(edge);
+    return true;
+}
+
+void CFGraph::Finalize() {
+    if(IsFinal())
+        return;
+
+    edges.insert(edges.end(), pendingEdges.begin(), pendingEdges.end());
+    pendingEdges.clear();
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // Counting sort into rows; edges are ordered by (from, to), so both the
+    // next and prev rows come out sorted
+    auto n = nodes.size();
+    nextAt.assign(n + 1, 0);
+    prevAt.assign(n + 1, 0);
+    for(auto& e : edges) {
+        nextAt[e.first + 1]++;
+        prevAt[e.second + 1]++;
+    }
+    for(size_t i = 0;i < n;i++) {
+        nextAt[i + 1] += nextAt[i];
+        prevAt[i + 1] += prevAt[i];
+    }
+
+    nextNodes.resize(edges.size());
+    prevNodes.resize(edges.size());
+    std::vector<uint32_t> prevFill(prevAt.begin(), prevAt.end() - 1);
+    for(size_t i = 0;i < edges.size();i++) {
+        nextNodes[i] = edges[i].second;
+        prevNodes[prevFill[edges[i].second]++] = edges[i].first;
+    }
+
+    reachable.assign((n + 63) / 64, 0);
+    if(n == 0)
+        return;
+
+    std::vector<uint32_t> todo = { 0 };
+    reachable[0] |= 1;
+    while(!todo.empty()) {
+        auto i = todo.back();
+        todo.pop_back();
+        for(auto next : Next(i)) {
+            auto& word = reachable[next / 64];
+            auto bit = 1ull << (next % 64);
+            if(!(word & bit)) {
+                word |= bit;
+                todo.push_back(next);
+            }
+        }
+    }
+}
+
+Span<const uint32_t> CFGraph::Next(size_t i) const {
+    assert(i + 1 < nextAt.size());
+    return Span<const uint32_t>(nextNodes.data() + nextAt[i], nextAt[i + 1] - nextAt[i]);
+}
+
+Span<const uint32_t> CFGraph::Prev(size_t i) const {
+    assert(i + 1 < prevAt.size());
+    return Span<const uint32_t>(prevNodes.data() + prevAt[i], prevAt[i + 1] - prevAt[i]);
+}
+
+bool CFGraph::IsReachable(size_t i) const {
+    assert(IsFinal());
+    return (reachable[i / 64] >> (i % 64)) & 1;
+}
+
+size_t CFGraph::IndexAt(size_t offset) const {
+    auto i = IndexContaining(offset);
+    if(i != npos && nodes[i].start == offset)
+        return i;
+    return npos;
+}
+
+size_t CFGraph::IndexContaining(size_t offset) const {
+    if(offset > UINT32_MAX)
+        return npos;
+
+    auto it = std::upper_bound(starts.begin(), starts.end(), (uint32_t)offset);
+    if(it == starts.begin())
+        return npos;
+
+    size_t i = (it - starts.begin()) - 1;
+    if(offset >= nodes[i].end)
+        return npos;
+    return i;
+}
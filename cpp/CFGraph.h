@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include "CFNode.h"
+#include "Span.h"
+
+/***
+ * The blocks of a program in offset order, addressed by index, with edges
+ * in compressed sparse row form: the successors of node i are
+ * nextNodes[nextAt[i] .. nextAt[i+1]), likewise for predecessors, each row
+ * sorted by index.
+ *
+ * Edges can be added while the graph is being solved. New ones are held
+ * aside until Finalize(), which rebuilds the rows and the reachability
+ * bitset; reading edges or reachability needs a finalized graph.
+ */
+class CFGraph {
+    std::vector<CFNode> nodes;
+    // Start offset of each node, kept apart so lookups search one dense array
+    std::vector<uint32_t> starts;
+
+    std::vector<std::pair<uint32_t, uint32_t> > edges, pendingEdges;
+    std::vector<uint32_t> nextAt, nextNodes;
+    std::vector<uint32_t> prevAt, prevNodes;
+    std::vector<uint64_t> reachable;
+public:
+    static constexpr size_t npos = (size_t)-1;
+
+    // Appends a node; its idx is set to its position. Nodes must be added in
+    // offset order.
+    CFNode& Add(CFNode node);
+
+    size_t Size() const { return nodes.size(); }
+    bool Empty() const { return nodes.empty(); }
+    CFNode& operator[](size_t i) { return nodes[i]; }
+    const CFNode& operator[](size_t i) const { return nodes[i]; }
+    std::vector<CFNode>::const_iterator begin() const { return nodes.begin(); }
+    std::vector<CFNode>::const_iterator end() const { return nodes.end(); }
+
+    // Returns false if the edge was already known
+    bool AddEdge(size_t from, size_t to);
+    bool IsFinal() const { return pendingEdges.empty() && nextAt.size() == nodes.size() + 1; }
+    void Finalize();
+
+    Span<const uint32_t> Next(size_t i) const;
+    Span<const uint32_t> Prev(size_t i) const;
+    size_t EdgeCount() const { return edges.size(); }
+
+    // Everything reachable from node 0 along known edges
+    bool IsReachable(size_t i) const;
+
+    // Node starting exactly at offset, or npos
+    size_t IndexAt(size_t offset) const;
+    // Node whose [start, end) holds offset, or npos
+    size_t IndexContaining(size_t offset) const;
+};
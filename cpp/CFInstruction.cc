@@ -6,19 +6,21 @@
 #include "CFInstruction.h"
 #include "Utils.h"
 
-CFInstruction::CFInstruction(const Program &program, size_t offset, const OpCodes::OpCode &opCode,
-                             const std::vector<uint8_t> &data) : program(program), offset(offset),
-                                                                                   opCode(opCode),
-                                                                                   data(data) {}
-
-void CFInstruction::simplify() {
+CFInstruction::CFInstruction(const Program &program, size_t index, size_t offset, const OpCodes::OpCode &opCode,
+                             Span<const uint8_t> data, Span<const CFExpression> operands,
+                             Span<const CFExpression> outputs) : program(program), index(index), offset(offset),
+                                                                 opCode(opCode), data(data),
+                                                                 operands(operands), outputs(outputs) {}
+
+void CFInstruction::simplify(ExpressionArena& arena, const OpCodes::OpCode& opCode,
+                             Span<const CFExpression> operands, Span<CFExpression> outputs) {
     if(opCode.dupNum() != -1) {
         outputs[0] = operands.back();
-        for(auto i = 1;i < outputs.size();i++) {
+        for(size_t i = 1;i < outputs.size();i++) {
             outputs[i] = operands[i-1];
         }
     } else if(opCode.swapNum() != -1) {
-        for(auto i = 0;i < outputs.size();i++) {
+        for(size_t i = 0;i < outputs.size();i++) {
             outputs[i] = operands[i];
         }
         std::swap(outputs[0], outputs[outputs.size() - 1]);
@@ -26,21 +28,19 @@ void CFInstruction::simplify() {
 
     if(opCode.isArithmetic()) {
         bool allInputsConstant = true;
-        std::vector<int64_t> inputs;
+        uint256 inputs[3];
 
-        for(auto& i : operands) {
-            int64_t o = 0;
-            allInputsConstant &= i.getConstantInt(&o);
-            inputs.push_back(o);
+        assert(operands.size() <= 3);
+        for(size_t i = 0;i < operands.size();i++) {
+            if(!operands[i].isConstant()) {
+                allInputsConstant = false;
+                break;
+            }
+            inputs[i] = arena.Value(operands[i]);
         }
 
         if(allInputsConstant) {
-            try {
-                outputs[0].constantValue = getVecFromInt64(opCode.Solve(inputs));
-                outputs[0].isConstant = true;
-            } catch(std::exception& e) {
-                std::cerr << e.what() << std::endl;
-            }
+            outputs[0] = arena.Constant(opCode.Solve(inputs));
         }
     }
 }
@@ -50,11 +50,13 @@ bool CFInstruction::allOutputsSingleUse() const {
     if(outputs.empty())
         return false;
     
+    auto& ssa = program.SSA();
     for(auto& op : outputs) {
         if(op.isSymbolic()) {
-            auto it = program.Symbols().find(op.idx);
-            assert(it != program.Symbols().end());
-            if(it != program.Symbols().end() && it->second.usedAt.size() > 1) {
+            auto v = ssa.OfSymbol(op.idx());
+            assert(v != SSAForm::NONE);
+            // Unused is fine; flowing on to another block is a second use
+            if(v != SSAForm::NONE && !ssa.Uses(v).empty() && !ssa.IsSingleUse(v)) {
                 return false;
             }
         }
@@ -64,7 +66,7 @@ bool CFInstruction::allOutputsSingleUse() const {
 
 bool CFInstruction::allOperandsConstant() const {
     for(auto& op : operands) {
-        if(!op.isConstant)
+        if(!op.isConstant())
             return false;
     }
     return true;
@@ -88,7 +90,7 @@ std::ostream &CFInstruction::Stream(std::ostream &os, bool showAllOps) const {
         if(outputs.size()) {
             os << "(";
             for(size_t i = 0;i < outputs.size();i++) {
-                os << outputs[i];
+                program.Expressions().Stream(os, outputs[i]);
                 if(i != outputs.size() - 1) {
                     os << ", ";
                 }
@@ -99,12 +101,12 @@ std::ostream &CFInstruction::Stream(std::ostream &os, bool showAllOps) const {
 
         for (size_t i = 0; i < operands.size(); i++) {
 
-            auto it = program.Symbols().find(operands[i].idx);
-            if(!showAllOps && it != program.Symbols().end() && it->second.usedAt.size() == 1) {
-                os << it->second.ToString(program);
+            auto v = operands[i].isSymbolic() ? program.SSA().OfSymbol(operands[i].idx()) : SSAForm::NONE;
+            if(!showAllOps && v != SSAForm::NONE && program.SSA().IsSingleUse(v)) {
+                os << program.RenderSymbol(operands[i].idx());
             } else {
                 int64_t addr = 0;
-                if(operands[i].isConstant && getInt64FromVec(operands[i].constantValue, &addr)) {
+                if(program.Expressions().GetConstantInt(operands[i], &addr)) {
                     if(auto n = program.GetNode(addr)) {
                         if(n->isJumpDest && n->start == addr)
                             os << " (loc_" << std::dec << n->idx << ") ";
@@ -113,7 +115,7 @@ std::ostream &CFInstruction::Stream(std::ostream &os, bool showAllOps) const {
                         os << " (possible entry: " << entryPoint->name << ") ";
                     }
                 }
-                os << operands[i];
+                program.Expressions().Stream(os, operands[i]);
             }
             if(i != operands.size() - 1)
                 os << ", ";
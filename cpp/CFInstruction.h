@@ -1,5 +1,3 @@
-
-
 #pragma once
 
 #include <memory>
@@ -10,28 +8,64 @@
 #include <set>
 #include "OpCodes.h"
 #include "CFExpression.h"
-#include "CFNode.h"
+#include "Span.h"
 
 struct CFInstruction;
+class Program;
 
+/***
+ * View of one entry in a Program's instruction store. Cheap to build and
+ * copy; it owns nothing and is only valid while the Program is alive.
+ */
 struct CFInstruction {
+    const Program& program;
+    size_t index;
     size_t offset;
     const OpCodes::OpCode& opCode;
-    std::vector<uint8_t> data;
+    Span<const uint8_t> data;
 
-    CFInstruction(const Program &program, size_t offset, const OpCodes::OpCode &opCode, const std::vector<uint8_t> &data = {});
+    Span<const CFExpression> operands;
+    Span<const CFExpression> outputs;
 
-    std::vector<CFExpression> operands;
-    std::vector<CFExpression> outputs;
+    CFInstruction(const Program &program, size_t index, size_t offset, const OpCodes::OpCode &opCode,
+                  Span<const uint8_t> data, Span<const CFExpression> operands, Span<const CFExpression> outputs);
 
     bool allOutputsSingleUse() const;
     bool allOperandsConstant() const;
 
-    void simplify();
+    static void simplify(ExpressionArena& arena, const OpCodes::OpCode& opCode,
+                         Span<const CFExpression> operands, Span<CFExpression> outputs);
 
     std::ostream &Stream(std::ostream &os, bool showAllOps) const;
 
-    const Program& program;
-
     friend std::ostream &operator<<(std::ostream &os, const CFInstruction &instruction);
-};
\ No newline at end of file
+};
+
+/***
+ * Instructions [first, last) of a program's store, in offset order.
+ */
+class InstructionRange {
+    const Program* program;
+    size_t first, last;
+public:
+    class iterator {
+        const Program* program;
+        size_t index;
+    public:
+        iterator(const Program* program, size_t index) : program(program), index(index) {}
+        CFInstruction operator*() const;
+        iterator& operator++() { index++; return *this; }
+        bool operator==(const iterator& rhs) const { return index == rhs.index; }
+        bool operator!=(const iterator& rhs) const { return index != rhs.index; }
+    };
+
+    InstructionRange(const Program& program, size_t first, size_t last) : program(&program), first(first), last(last) {}
+
+    iterator begin() const { return iterator(program, first); }
+    iterator end() const { return iterator(program, last); }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    size_t First() const { return first; }
+    size_t Last() const { return last; }
+    CFInstruction back() const;
+};
@@ -1,45 +1,48 @@
 #pragma once
 
-#include <memory>
 #include <vector>
-#include <sstream>
-#include <algorithm>
-#include <map>
-#include <set>
-#include <unordered_set>
+#include <string>
+#include <unordered_map>
+#include <optional>
 #include "CFExpression.h"
-#include "Program.h"
+#include "CFInstruction.h"
+#include "ExecutionPaths.h"
 
-class CFInstruction;
+struct CFInstruction;
+class InstructionRange;
 class Program;
 
-class CFNode : public std::enable_shared_from_this<CFNode> {
-    mutable bool isReachable = false, isReachableStale = true;
-    std::set<std::shared_ptr<CFNode>> next, prev;
+// Handle into the owning program's ExecutionPaths
+typedef ExecutionPaths::Path executionPath;
+// Stack states are hashed on their handles; no ordering is implied
+typedef std::unordered_map<CFStack, std::vector<executionPath>, CFStackHash> CFStackStates;
+
+/***
+ * A basic block. Blocks live in the program's CFGraph and are addressed by
+ * idx, which is also their position there; edges are kept by the graph.
+ */
+class CFNode {
 public:
     size_t start = 0,
             end = 0;
+    // Indices into the program's instruction store, [first, last)
+    size_t first = 0,
+            last = 0;
 
     size_t idx = 0;
     bool isJumpDest = false;
-    std::string label = "";
-
-    bool IsReachable() const;
-    void ClearNextAndPrev() {
-        next.clear();
-        prev.clear();
-    }
-    const std::set<std::shared_ptr<CFNode>>& NextNodes() const;
-    const std::set<std::shared_ptr<CFNode>>& PrevNodes() const;
-    void AddNext(const std::shared_ptr<CFNode>& next);
-    std::vector<std::shared_ptr<CFInstruction>> Instructions(const Program& p) const;
+    // Set by the stack solver: a loop head whose states were widened, and a
+    // block that had more calling contexts than it keeps
+    bool isWidened = false;
+    bool isStateCapped = false;
+
+    InstructionRange Instructions(const Program& p) const;
     bool hasUnknownOpCodes(const Program& p) const;
-    std::shared_ptr<CFInstruction> lastInstruction(const Program& p) const;
+    std::optional<CFInstruction> lastInstruction(const Program& p) const;
 
     bool HasPossibleEntryStackStates() const;
-    std::map<std::vector<CFExpression>, std::vector<std::vector<size_t>> > possibleEntryStackStates;
+    CFStackStates possibleEntryStackStates;
 
     bool HasPossibleExitStackStates() const;
-    std::map<std::vector<CFExpression>, std::vector<std::vector<size_t>> > possibleExitStackStates;
+    CFStackStates possibleExitStackStates;
 };
-
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+/***
+ * The blocks as the stack solver saw them: a node per state a block was
+ * solved in, so one per context (the jump destinations on its entry stack),
+ * with edges to the states its exit was sent into. A return jump out of a
+ * shared internal function thus only leads back to the caller whose return
+ * address that state held, where the graph's own edges lead to them all.
+ *
+ * A block the solver left without states, and a state whose exit was never
+ * worked out, gets edges to every node of the block's graph successors.
+ */
+class ContextGraph {
+public:
+    struct Node {
+        uint32_t block;
+        // Sorted
+        std::vector<uint32_t> next;
+    };
+
+    ContextGraph() = default;
+
+    size_t Size() const { return nodes.size(); }
+    const Node& operator[](size_t i) const { return nodes[i]; }
+    // The nodes of block are [Begin(block), End(block)); never empty
+    size_t Begin(size_t block) const { return nodesAt[block]; }
+    size_t End(size_t block) const { return nodesAt[block + 1]; }
+private:
+    friend class StackSolver;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> nodesAt;
+};
@@ -0,0 +1,71 @@
+#include <assert.h>
+#include <algorithm>
+#include "ExecutionPaths.h"
+
+ExecutionPaths::ExecutionPaths(const ExecutionPaths *base) : base(base) {
+    if(base)
+        baseSize = base->Size();
+    else
+        links.push_back({EMPTY, 0, 0});
+}
+
+bool ExecutionPaths::find(uint64_t key, Path &path) const {
+    if(base && base->find(key, path))
+        return true;
+    auto it = interned.find(key);
+    if(it == interned.end())
+        return false;
+    path = it->second;
+    return true;
+}
+
+ExecutionPaths::Path ExecutionPaths::Extend(Path path, size_t node) {
+    assert(path < Size() && node <= UINT32_MAX);
+    auto key = ((uint64_t)path << 32) | (uint32_t)node;
+    Path rtn = EMPTY;
+    if(find(key, rtn))
+        return rtn;
+
+    rtn = (Path)Size();
+    links.push_back({path, (uint32_t)node, link(path).length + 1});
+    interned.emplace(key, rtn);
+    return rtn;
+}
+
+bool ExecutionPaths::Contains(Path path, size_t node) const {
+    for(;path != EMPTY;path = link(path).parent) {
+        if(link(path).node == node)
+            return true;
+    }
+    return false;
+}
+
+std::vector<size_t> ExecutionPaths::Materialize(Path path) const {
+    std::vector<size_t> rtn;
+    rtn.reserve(Length(path));
+    for(;path != EMPTY;path = link(path).parent) {
+        rtn.push_back(link(path).node);
+    }
+    std::reverse(rtn.begin(), rtn.end());
+    return rtn;
+}
+
+ExecutionPaths::Path ExecutionPaths::Import(const ExecutionPaths &other, Path path, std::vector<Path> &memo) {
+    assert(other.base == this);
+    auto shared = other.baseSize;
+    // No import ever yields EMPTY, so it marks links not yet brought over
+    memo.resize(other.Size() - shared, EMPTY);
+
+    std::vector<Path> chain;
+    while(path >= shared && memo[path - shared] == EMPTY) {
+        chain.push_back(path);
+        path = other.link(path).parent;
+    }
+
+    auto rtn = path < shared ? path : memo[path - shared];
+    for(auto it = chain.rbegin();it != chain.rend();++it) {
+        rtn = Extend(rtn, other.link(*it).node);
+        memo[*it - shared] = rtn;
+    }
+    return rtn;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+/***
+ * Execution paths stored as parent pointers: a path is a handle to its last
+ * link, and each link names one node and the path before it. Extending a
+ * path is one append, every prefix is shared, and links are interned, so
+ * two paths through the same nodes have the same handle.
+ *
+ * Node lists are only built when something prints a path.
+ *
+ * Like ExpressionArena, a store can be layered over an unchanging base
+ * store, holding only the links it adds.
+ */
+class ExecutionPaths {
+public:
+    typedef uint32_t Path;
+    // The path that has not passed through any node yet
+    static constexpr Path EMPTY = 0;
+
+    explicit ExecutionPaths(const ExecutionPaths* base = nullptr);
+
+    Path Extend(Path path, size_t node);
+    bool Contains(Path path, size_t node) const;
+    size_t Length(Path path) const { return link(path).length; }
+    // Nodes in the order they were visited
+    std::vector<size_t> Materialize(Path path) const;
+
+    // Same path in this store as path is in other, a store layered over
+    // this one. memo caches the links already brought over from other; pass
+    // the same vector each time.
+    Path Import(const ExecutionPaths& other, Path path, std::vector<Path>& memo);
+
+    size_t Size() const { return baseSize + links.size(); }
+private:
+    struct Link {
+        uint32_t parent;
+        uint32_t node;
+        uint32_t length;
+    };
+    std::vector<Link> links;
+    std::unordered_map<uint64_t, Path> interned;
+
+    const ExecutionPaths* base = nullptr;
+    size_t baseSize = 0;
+
+    const Link& link(Path path) const { return path < baseSize ? base->link(path) : links[path - baseSize]; }
+    bool find(uint64_t key, Path& path) const;
+};
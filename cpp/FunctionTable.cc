@@ -0,0 +1,210 @@
+#include <assert.h>
+#include <algorithm>
+#include "FunctionTable.h"
+#include "Program.h"
+
+// How far back through phis and masks a selector is followed
+static const size_t MAX_SELECTOR_DEPTH = 8;
+
+static bool constantOf(const Program& program, SSAForm::Value v, uint256& value) {
+    auto& ssa = program.SSA();
+    if(v == SSAForm::NONE || ssa.KindOf(v) != SSAForm::CONSTANT || !ssa.Expression(v).isConstant())
+        return false;
+    value = program.Expressions().Value(ssa.Expression(v));
+    return true;
+}
+
+static bool isConstant(const Program& program, SSAForm::Value v, const uint256& expected) {
+    uint256 value;
+    return constantOf(program, v, value) && value == expected;
+}
+
+// The output of CALLDATALOAD(0)
+static bool isCallDataHead(const Program& program, SSAForm::Value v) {
+    auto& ssa = program.SSA();
+    if(v == SSAForm::NONE || ssa.KindOf(v) != SSAForm::OUTPUT)
+        return false;
+    auto i = ssa.DefinedAt(v);
+    return program.Store().OpCodeAt(i).opCode == OpCodes::OP_CALLDATALOAD && isConstant(program, ssa.Operands(i)[0], 0);
+}
+
+// The top four bytes of the call data
+static bool isSelector(const Program& program, SSAForm::Value v, size_t depth) {
+    auto& ssa = program.SSA();
+    if(v == SSAForm::NONE || depth > MAX_SELECTOR_DEPTH)
+        return false;
+
+    if(ssa.KindOf(v) == SSAForm::PHI) {
+        for(auto incoming : ssa.Incoming(v)) {
+            if(incoming != v && !isSelector(program, incoming, depth + 1))
+                return false;
+        }
+        return true;
+    }
+    if(ssa.KindOf(v) != SSAForm::OUTPUT)
+        return false;
+
+    auto i = ssa.DefinedAt(v);
+    auto operands = ssa.Operands(i);
+    switch(program.Store().OpCodeAt(i).opCode) {
+        case OpCodes::OP_DIV:
+            return isCallDataHead(program, operands[0]) && isConstant(program, operands[1], uint256(1) << 224);
+        case OpCodes::OP_SHR:
+            return isConstant(program, operands[0], 224) && isCallDataHead(program, operands[1]);
+        case OpCodes::OP_AND:
+            for(size_t k = 0;k < 2;k++) {
+                if(isConstant(program, operands[k], 0xffffffff) && isSelector(program, operands[1 - k], depth + 1))
+                    return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool FunctionTable::Function::Contains(size_t block) const {
+    return std::binary_search(blocks.begin(), blocks.end(), (uint32_t)block);
+}
+
+std::optional<KnownEntryPoint> FunctionTable::Function::Known() const {
+    return GetKnownEntryPoint(selector);
+}
+
+FunctionTable::FunctionTable(const Program &program) {
+    auto& graph = program.Graph();
+    auto& store = program.Store();
+    auto& ssa = program.SSA();
+
+    // Every dispatch found, and the block it is tested in
+    std::vector<Function> found;
+    std::vector<size_t> testedIn;
+    for(auto& node : graph) {
+        if(node.last == node.first || !graph.IsReachable(node.idx))
+            continue;
+        auto jump = node.last - 1;
+        if(store.OpCodeAt(jump).opCode != OpCodes::OP_JUMPI)
+            continue;
+
+        auto condition = ssa.Operands(jump)[1];
+        if(condition == SSAForm::NONE || ssa.KindOf(condition) != SSAForm::OUTPUT)
+            continue;
+        auto compare = ssa.DefinedAt(condition);
+        if(store.OpCodeAt(compare).opCode != OpCodes::OP_EQ)
+            continue;
+
+        uint256 selector;
+        bool isDispatch = false;
+        auto operands = ssa.Operands(compare);
+        for(size_t k = 0;k < 2 && !isDispatch;k++) {
+            isDispatch = constantOf(program, operands[k], selector) && selector <= uint256(0xffffffff) &&
+                         isSelector(program, operands[1 - k], 0);
+        }
+
+        int64_t target = 0;
+        if(!isDispatch || !program.Expressions().GetConstantInt(store.Operands(jump)[0], &target))
+            continue;
+        auto entry = graph.IndexAt(target);
+        if(entry == CFGraph::npos || entry == 0 || !graph[entry].isJumpDest)
+            continue;
+
+        Function function;
+        function.selector = (uint32_t)selector.limbs[0];
+        function.entry = entry;
+        function.dispatchedAt = store.Offset(jump);
+        found.push_back(std::move(function));
+        testedIn.push_back(node.idx);
+    }
+
+    // A selector tested more than once goes where the test run first sends
+    // it: the one whose block dominates the others'. Tests that don't
+    // dominate each other are on different branches, as in a dispatcher
+    // split into ranges by GT/LT, and only one of them can see the
+    // selector. Which one is not worked out here; the first in the code is
+    // kept.
+    std::vector<size_t> order(found.size());
+    for(size_t k = 0;k < order.size();k++)
+        order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return found[a].selector < found[b].selector;
+    });
+    auto& analysis = program.Analysis();
+    for(size_t k = 0;k < order.size();) {
+        auto first = order[k];
+        for(k++;k < order.size() && found[order[k]].selector == found[first].selector;k++) {
+            if(analysis.Dominates(testedIn[order[k]], testedIn[first]))
+                first = order[k];
+        }
+        functions.push_back(std::move(found[first]));
+    }
+
+    std::vector<bool> isEntry(graph.Size());
+    for(auto& function : functions)
+        isEntry[function.entry] = true;
+
+    std::vector<bool> isVisited;
+    std::vector<uint32_t> work;
+    for(auto& function : functions) {
+        auto it = program.solvedFunctions.find(function.entry);
+        if(it != program.solvedFunctions.end()) {
+            function.isTruncated = it->second.isTruncated;
+            if(!it->second.blocks.empty()) {
+                function.blocks = it->second.blocks;
+                function.isSolved = true;
+            }
+        }
+
+        if(!function.isSolved) {
+            isVisited.assign(graph.Size(), false);
+            isVisited[function.entry] = true;
+            work.assign(1, (uint32_t)function.entry);
+            while(!work.empty()) {
+                auto b = work.back();
+                work.pop_back();
+                function.blocks.push_back(b);
+                for(auto next : graph.Next(b)) {
+                    if(!isVisited[next] && !isEntry[next]) {
+                        isVisited[next] = true;
+                        work.push_back(next);
+                    }
+                }
+            }
+            std::sort(function.blocks.begin(), function.blocks.end());
+        }
+
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto add = [&](uint64_t byte) {
+            hash ^= byte;
+            hash *= 0x100000001b3ull;
+        };
+        for(auto b : function.blocks) {
+            auto& node = graph[b];
+            for(size_t i = node.first;i < node.last;i++) {
+                auto& opCode = store.OpCodeAt(i);
+                add(opCode.opCode);
+                auto immediate = program.ByteCode().data() + store.Offset(i) + 1;
+
+                // Jump destinations in the slice by their place in it
+                uint64_t value = 0;
+                for(size_t k = 0;k < opCode.length && k < 8;k++)
+                    value = value << 8 | immediate[k];
+                auto target = opCode.length <= 4 ? graph.IndexAt(value) : CFGraph::npos;
+                if(target != CFGraph::npos && graph[target].isJumpDest && function.Contains(target)) {
+                    auto place = std::lower_bound(function.blocks.begin(), function.blocks.end(), target) -
+                                 function.blocks.begin();
+                    add(0x100 | (uint64_t)place << 9);
+                    continue;
+                }
+                for(size_t k = 0;k < opCode.length;k++)
+                    add(immediate[k]);
+            }
+        }
+        function.bodyHash = hash;
+    }
+}
+
+const FunctionTable::Function *FunctionTable::Find(uint32_t selector) const {
+    auto it = std::lower_bound(functions.begin(), functions.end(), selector, [](const Function& f, uint32_t s) {
+        return f.selector < s;
+    });
+    return it != functions.end() && it->selector == selector ? &*it : nullptr;
+}
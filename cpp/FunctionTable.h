@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <optional>
+#include <vector>
+#include "SSAForm.h"
+#include "SelectorDatabase.h"
+
+class Program;
+
+/***
+ * The public functions of a contract, found from its selector dispatcher:
+ * a JUMPI on EQ(selector, constant), the selector being CALLDATALOAD(0)
+ * brought down to its top four bytes by DIV 2^224 or SHR 224 (and maybe an
+ * AND 0xffffffff). The dispatch is followed through the SSA, so it is found
+ * however the selector was kept on the stack, and through the jumps of a
+ * dispatcher split by GT/LT into ranges.
+ *
+ * A function's slice is the blocks that make it up. Where the stack solver
+ * solved the function on its own, those are the blocks that solve reached,
+ * which keeps shared internal functions from leading into the other
+ * callers' code. Otherwise they are the blocks reachable from its entry
+ * without going through another function's entry.
+ */
+class FunctionTable {
+public:
+    struct Function {
+        uint32_t selector = 0;
+        // Block the dispatcher jumps to
+        size_t entry = 0;
+        // Offset of the dispatching JUMPI
+        size_t dispatchedAt = 0;
+        // Block indices, sorted
+        std::vector<uint32_t> blocks;
+        // Blocks came from the function's own solve
+        bool isSolved = false;
+        // The budget cut the function's solve short
+        bool isTruncated = false;
+        // FNV-1a over the slice's code with jump destinations inside it
+        // numbered by block, so the same body hashes the same in any
+        // contract
+        uint64_t bodyHash = 0;
+
+        bool Contains(size_t block) const;
+        std::optional<KnownEntryPoint> Known() const;
+    };
+
+    FunctionTable() = default;
+    // program's SSA form must be built
+    explicit FunctionTable(const Program& program);
+
+    // Sorted by selector
+    const std::vector<Function>& Functions() const { return functions; }
+    const Function* Find(uint32_t selector) const;
+    bool Empty() const { return functions.empty(); }
+private:
+    std::vector<Function> functions;
+};
@@ -0,0 +1,223 @@
+#include <assert.h>
+#include <algorithm>
+#include "GraphAnalysis.h"
+
+bool GraphAnalysis::DominatorTree::Dominates(size_t a, size_t b) const {
+    if(!Contains(a) || !Contains(b))
+        return false;
+    return pre[a] <= pre[b] && post[b] <= post[a];
+}
+
+template <typename Succ, typename Pred>
+void GraphAnalysis::build(DominatorTree &tree, size_t size, size_t entry, Succ forEachSucc, Pred forEachPred) {
+    // Reverse postorder from the entry
+    std::vector<uint32_t> order, rpo(size, NONE);
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> stack;
+    std::vector<bool> isSeen(size);
+    auto push = [&](size_t node) {
+        isSeen[node] = true;
+        std::vector<uint32_t> next;
+        forEachSucc(node, [&](size_t s) { next.push_back((uint32_t)s); });
+        std::reverse(next.begin(), next.end());
+        stack.emplace_back((uint32_t)node, std::move(next));
+    };
+    push(entry);
+    while(!stack.empty()) {
+        auto& top = stack.back();
+        if(top.second.empty()) {
+            order.push_back(top.first);
+            stack.pop_back();
+            continue;
+        }
+        auto next = top.second.back();
+        top.second.pop_back();
+        if(!isSeen[next])
+            push(next);
+    }
+    std::reverse(order.begin(), order.end());
+    for(size_t i = 0;i < order.size();i++)
+        rpo[order[i]] = (uint32_t)i;
+
+    auto& idom = tree.idom;
+    idom.assign(size, NONE);
+    idom[entry] = (uint32_t)entry;
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while(a != b) {
+            while(rpo[a] > rpo[b])
+                a = idom[a];
+            while(rpo[b] > rpo[a])
+                b = idom[b];
+        }
+        return a;
+    };
+
+    bool isChanged = true;
+    while(isChanged) {
+        isChanged = false;
+        for(size_t i = 1;i < order.size();i++) {
+            auto node = order[i];
+            auto newIdom = NONE;
+            forEachPred(node, [&](size_t p) {
+                if(rpo[p] == NONE || idom[p] == NONE)
+                    return;
+                newIdom = newIdom == NONE ? (uint32_t)p : intersect((uint32_t)p, newIdom);
+            });
+            if(newIdom != idom[node]) {
+                idom[node] = newIdom;
+                isChanged = true;
+            }
+        }
+    }
+
+    // Number the tree so dominance is an interval check
+    std::vector<uint32_t> childAt(size + 1, 0), children(order.size());
+    for(auto node : order) {
+        if(node != entry)
+            childAt[idom[node] + 1]++;
+    }
+    for(size_t i = 0;i < size;i++)
+        childAt[i + 1] += childAt[i];
+    std::vector<uint32_t> fill(childAt.begin(), childAt.end() - 1);
+    for(auto node : order) {
+        if(node != entry)
+            children[fill[idom[node]]++] = node;
+    }
+
+    tree.pre.assign(size, NONE);
+    tree.post.assign(size, NONE);
+    uint32_t preCount = 0, postCount = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> walk = { { (uint32_t)entry, childAt[entry] } };
+    tree.pre[entry] = preCount++;
+    while(!walk.empty()) {
+        auto& top = walk.back();
+        if(top.second == childAt[top.first + 1]) {
+            tree.post[top.first] = postCount++;
+            walk.pop_back();
+            continue;
+        }
+        auto child = children[top.second++];
+        tree.pre[child] = preCount++;
+        walk.emplace_back(child, childAt[child]);
+    }
+    idom[entry] = NONE;
+}
+
+GraphAnalysis::GraphAnalysis(const CFGraph &graph) {
+    assert(graph.IsFinal());
+    auto n = graph.Size();
+    if(n == 0)
+        return;
+
+    build(dominators, n, 0,
+          [&](size_t node, auto visit) { for(auto s : graph.Next(node)) visit(s); },
+          [&](size_t node, auto visit) { for(auto p : graph.Prev(node)) visit(p); });
+
+    // Post dominators: the same on the reversed graph, entered from a
+    // virtual exit (node n) that every block without successors leads to
+    auto exit = n;
+    build(postDominators, n + 1, exit,
+          [&](size_t node, auto visit) {
+              if(node == exit) {
+                  for(size_t i = 0;i < n;i++) {
+                      if(graph.Next(i).empty())
+                          visit(i);
+                  }
+              } else {
+                  for(auto p : graph.Prev(node)) visit(p);
+              }
+          },
+          [&](size_t node, auto visit) {
+              if(node == exit)
+                  return;
+              for(auto s : graph.Next(node)) visit(s);
+              if(graph.Next(node).empty())
+                  visit(exit);
+          });
+
+    findLoops(graph);
+}
+
+void GraphAnalysis::findLoops(const CFGraph &graph) {
+    auto n = graph.Size();
+    std::vector<size_t> headerLoop(n, npos);
+    for(size_t from = 0;from < n;from++) {
+        for(auto to : graph.Next(from)) {
+            if(!Dominates(to, from))
+                continue;
+            if(headerLoop[to] == npos) {
+                headerLoop[to] = loops.size();
+                loops.push_back(Loop());
+                loops.back().header = to;
+            }
+            loops[headerLoop[to]].latches.push_back((uint32_t)from);
+        }
+    }
+
+    // Body: everything that reaches a latch without passing the header
+    std::vector<uint32_t> mark(n, NONE), todo;
+    for(size_t l = 0;l < loops.size();l++) {
+        auto& loop = loops[l];
+        mark[loop.header] = (uint32_t)l;
+        loop.blocks.push_back((uint32_t)loop.header);
+        for(auto latch : loop.latches) {
+            if(mark[latch] != l) {
+                mark[latch] = (uint32_t)l;
+                loop.blocks.push_back(latch);
+                todo.push_back(latch);
+            }
+        }
+        while(!todo.empty()) {
+            auto node = todo.back();
+            todo.pop_back();
+            for(auto p : graph.Prev(node)) {
+                if(mark[p] != l && dominators.Contains(p)) {
+                    mark[p] = (uint32_t)l;
+                    loop.blocks.push_back(p);
+                    todo.push_back(p);
+                }
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+    }
+
+    // Nested loops are subsets, so going from big to small leaves every
+    // block with its innermost loop, and a loop's header pointing at the
+    // loop around it just before the loop itself is filled in
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) {
+        return a.blocks.size() != b.blocks.size() ? a.blocks.size() > b.blocks.size() : a.header < b.header;
+    });
+    loopOf.assign(n, NONE);
+    for(size_t l = 0;l < loops.size();l++) {
+        auto& loop = loops[l];
+        auto outer = loopOf[loop.header];
+        loop.parent = outer == NONE ? npos : outer;
+        loop.depth = outer == NONE ? 1 : loops[outer].depth + 1;
+        for(auto node : loop.blocks)
+            loopOf[node] = (uint32_t)l;
+    }
+}
+
+size_t GraphAnalysis::ImmediateDominator(size_t node) const {
+    auto idom = dominators.idom[node];
+    return idom == NONE ? npos : idom;
+}
+
+size_t GraphAnalysis::ImmediatePostDominator(size_t node) const {
+    auto idom = postDominators.idom[node];
+    // The virtual exit is not a block
+    return idom == NONE || idom == dominators.idom.size() ? npos : idom;
+}
+
+size_t GraphAnalysis::LoopOf(size_t node) const {
+    return loopOf.empty() || loopOf[node] == NONE ? npos : loopOf[node];
+}
+
+bool GraphAnalysis::IsLoopHeader(size_t node) const {
+    auto l = LoopOf(node);
+    return l != npos && loops[l].header == node;
+}
+
+size_t GraphAnalysis::LoopDepth(size_t node) const {
+    auto l = LoopOf(node);
+    return l == npos ? 0 : loops[l].depth;
+}
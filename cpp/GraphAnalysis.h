@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "CFGraph.h"
+
+/***
+ * Dominance and loop structure of a finished graph, built once per program.
+ *
+ * Dominators are over the blocks reachable from the entry; post dominators
+ * are over the blocks that can reach an exit (a block without successors),
+ * through a virtual exit joining them all. Both are computed with the
+ * iterative algorithm of Cooper, Harvey and Kennedy and then numbered, so a
+ * dominance query is two compares.
+ *
+ * Loops are natural loops: a back edge is one whose target dominates its
+ * source, and back edges to the same header make one loop. Retreating edges
+ * into the middle of an irreducible cycle are not loops here.
+ */
+class GraphAnalysis {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct DominatorTree {
+        std::vector<uint32_t> idom;
+        // Preorder and postorder numbers in the tree; NONE when not in it
+        std::vector<uint32_t> pre, post;
+
+        bool Contains(size_t node) const { return pre[node] != NONE; }
+        bool Dominates(size_t a, size_t b) const;
+    };
+
+    DominatorTree dominators, postDominators;
+
+    template <typename Succ, typename Pred>
+    static void build(DominatorTree& tree, size_t size, size_t entry, Succ forEachSucc, Pred forEachPred);
+    void findLoops(const CFGraph& graph);
+public:
+    struct Loop {
+        size_t header;
+        // Enclosing loop, or npos
+        size_t parent;
+        // 1 for an outermost loop
+        size_t depth;
+        // Sources of the back edges
+        std::vector<uint32_t> latches;
+        // Every block in the loop, header and nested loops included, sorted
+        std::vector<uint32_t> blocks;
+    };
+private:
+    // Outer loops come before the loops they hold
+    std::vector<Loop> loops;
+    // Innermost loop of each block
+    std::vector<uint32_t> loopOf;
+public:
+    static constexpr size_t npos = CFGraph::npos;
+
+    GraphAnalysis() = default;
+    // graph must be finalized
+    explicit GraphAnalysis(const CFGraph& graph);
+
+    // Every path from the entry to b passes through a; false if either is
+    // unreachable. A block dominates itself.
+    bool Dominates(size_t a, size_t b) const { return dominators.Dominates(a, b); }
+    // npos for the entry and unreachable blocks
+    size_t ImmediateDominator(size_t node) const;
+
+    // Every path from b to an exit passes through a; false if either never
+    // reaches an exit
+    bool PostDominates(size_t a, size_t b) const { return postDominators.Dominates(a, b); }
+    // npos if nothing but the virtual exit post dominates node
+    size_t ImmediatePostDominator(size_t node) const;
+
+    const std::vector<Loop>& Loops() const { return loops; }
+    // Index into Loops() of the innermost loop holding node, or npos
+    size_t LoopOf(size_t node) const;
+    bool IsLoopHeader(size_t node) const;
+    // How many loops hold node
+    size_t LoopDepth(size_t node) const;
+};
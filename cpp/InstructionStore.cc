@@ -0,0 +1,28 @@
+#include "InstructionStore.h"
+
+void InstructionStore::Build(const std::vector<uint8_t> &byteCode) {
+    size_t count = 0, arenaSize = 0;
+    OpCodes::iterate(byteCode, [&](const uint8_t*, size_t, const OpCodes::OpCode& opCode) {
+        count++;
+        arenaSize += opCode.stackRemoved + opCode.stackAdded;
+    });
+
+    opCodes.reserve(count);
+    offsets.reserve(count);
+    expressionsAt.reserve(count);
+    expressions.resize(arenaSize);
+    firstAtOrAfter.resize(byteCode.size() + 1);
+
+    size_t filled = 0, arenaAt = 0;
+    OpCodes::iterate(byteCode, [&](const uint8_t*, size_t pos, const OpCodes::OpCode& opCode) {
+        while(filled <= pos)
+            firstAtOrAfter[filled++] = offsets.size();
+
+        opCodes.push_back(opCode.opCode);
+        offsets.push_back(pos);
+        expressionsAt.push_back(arenaAt);
+        arenaAt += opCode.stackRemoved + opCode.stackAdded;
+    });
+    while(filled < firstAtOrAfter.size())
+        firstAtOrAfter[filled++] = offsets.size();
+}
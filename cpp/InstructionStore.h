@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+#include "OpCodes.h"
+#include "CFExpression.h"
+#include "Span.h"
+
+/***
+ * Dense, offset sorted instruction stream kept as parallel arrays. An
+ * instruction's immediate bytes are read straight out of the bytecode, and
+ * its operands and outputs live back to back in one shared expression arena
+ * (their counts come from the opcode).
+ *
+ * firstAtOrAfter maps every byte offset to the first instruction starting
+ * at or after it, so offset lookups and [start, end) ranges are O(1).
+ */
+class InstructionStore {
+    std::vector<uint8_t> opCodes;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> expressionsAt;
+    std::vector<CFExpression> expressions;
+    std::vector<uint32_t> firstAtOrAfter;
+
+public:
+    static const size_t npos = (size_t)-1;
+
+    void Build(const std::vector<uint8_t>& byteCode);
+
+    size_t Size() const { return offsets.size(); }
+    bool Empty() const { return offsets.empty(); }
+
+    size_t Offset(size_t i) const { return offsets[i]; }
+    const OpCodes::OpCode& OpCodeAt(size_t i) const { return OpCodes::get(opCodes[i]); }
+
+    Span<CFExpression> Operands(size_t i) {
+        return Span<CFExpression>(expressions.data() + expressionsAt[i], OpCodeAt(i).stackRemoved);
+    }
+    Span<const CFExpression> Operands(size_t i) const {
+        return Span<const CFExpression>(expressions.data() + expressionsAt[i], OpCodeAt(i).stackRemoved);
+    }
+    Span<CFExpression> Outputs(size_t i) {
+        auto& opCode = OpCodeAt(i);
+        return Span<CFExpression>(expressions.data() + expressionsAt[i] + opCode.stackRemoved, opCode.stackAdded);
+    }
+    Span<const CFExpression> Outputs(size_t i) const {
+        auto& opCode = OpCodeAt(i);
+        return Span<const CFExpression>(expressions.data() + expressionsAt[i] + opCode.stackRemoved, opCode.stackAdded);
+    }
+
+    // Index of the first instruction starting at or after offset
+    size_t LowerBound(size_t offset) const {
+        if(offset >= firstAtOrAfter.size())
+            return Size();
+        return firstAtOrAfter[offset];
+    }
+
+    // Index of the instruction starting exactly at offset, or npos
+    size_t IndexAt(size_t offset) const {
+        auto i = LowerBound(offset);
+        if(i < Size() && offsets[i] == offset)
+            return i;
+        return npos;
+    }
+};
@@ -0,0 +1,207 @@
+#include <string.h>
+#include <ctype.h>
+#include "Keccak.h"
+
+static const uint64_t roundConstants[24] = {
+        0x0000000000000001ull, 0x0000000000008082ull, 0x800000000000808Aull, 0x8000000080008000ull,
+        0x000000000000808Bull, 0x0000000080000001ull, 0x8000000080008081ull, 0x8000000000008009ull,
+        0x000000000000008Aull, 0x0000000000000088ull, 0x0000000080008009ull, 0x000000008000000Aull,
+        0x000000008000808Bull, 0x800000000000008Bull, 0x8000000000008089ull, 0x8000000000008003ull,
+        0x8000000000008002ull, 0x8000000000000080ull, 0x000000000000800Aull, 0x800000008000000Aull,
+        0x8000000080008081ull, 0x8000000000008080ull, 0x0000000080000001ull, 0x8000000080008008ull,
+};
+
+static inline uint64_t rotl(uint64_t v, int n) {
+    return (v << n) | (v >> (64 - n));
+}
+
+// Keccak-f[1600] on lanes a[x + 5y], with every step spelled out so it
+// does not depend on the optimizer unrolling it
+static void permute(uint64_t a[25]) {
+    uint64_t b[25], c[5], d[5];
+    for(int round = 0;round < 24;round++) {
+        // Theta
+        c[0] = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+        c[1] = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+        c[2] = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+        c[3] = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+        c[4] = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+        d[0] = c[4] ^ rotl(c[1], 1);
+        d[1] = c[0] ^ rotl(c[2], 1);
+        d[2] = c[1] ^ rotl(c[3], 1);
+        d[3] = c[2] ^ rotl(c[4], 1);
+        d[4] = c[3] ^ rotl(c[0], 1);
+        a[0] ^= d[0]; a[5] ^= d[0]; a[10] ^= d[0]; a[15] ^= d[0]; a[20] ^= d[0];
+        a[1] ^= d[1]; a[6] ^= d[1]; a[11] ^= d[1]; a[16] ^= d[1]; a[21] ^= d[1];
+        a[2] ^= d[2]; a[7] ^= d[2]; a[12] ^= d[2]; a[17] ^= d[2]; a[22] ^= d[2];
+        a[3] ^= d[3]; a[8] ^= d[3]; a[13] ^= d[3]; a[18] ^= d[3]; a[23] ^= d[3];
+        a[4] ^= d[4]; a[9] ^= d[4]; a[14] ^= d[4]; a[19] ^= d[4]; a[24] ^= d[4];
+
+        // Rho and pi: lane (x, y) rotates into (y, 2x + 3y)
+        b[ 0] = a[ 0];
+        b[10] = rotl(a[ 1],  1);
+        b[20] = rotl(a[ 2], 62);
+        b[ 5] = rotl(a[ 3], 28);
+        b[15] = rotl(a[ 4], 27);
+        b[16] = rotl(a[ 5], 36);
+        b[ 1] = rotl(a[ 6], 44);
+        b[11] = rotl(a[ 7],  6);
+        b[21] = rotl(a[ 8], 55);
+        b[ 6] = rotl(a[ 9], 20);
+        b[ 7] = rotl(a[10],  3);
+        b[17] = rotl(a[11], 10);
+        b[ 2] = rotl(a[12], 43);
+        b[12] = rotl(a[13], 25);
+        b[22] = rotl(a[14], 39);
+        b[23] = rotl(a[15], 41);
+        b[ 8] = rotl(a[16], 45);
+        b[18] = rotl(a[17], 15);
+        b[ 3] = rotl(a[18], 21);
+        b[13] = rotl(a[19],  8);
+        b[14] = rotl(a[20], 18);
+        b[24] = rotl(a[21],  2);
+        b[ 9] = rotl(a[22], 61);
+        b[19] = rotl(a[23], 56);
+        b[ 4] = rotl(a[24], 14);
+
+        // Chi, a row at a time
+#define CHI_ROW(y) \
+        a[y + 0] = b[y + 0] ^ (~b[y + 1] & b[y + 2]); \
+        a[y + 1] = b[y + 1] ^ (~b[y + 2] & b[y + 3]); \
+        a[y + 2] = b[y + 2] ^ (~b[y + 3] & b[y + 4]); \
+        a[y + 3] = b[y + 3] ^ (~b[y + 4] & b[y + 0]); \
+        a[y + 4] = b[y + 4] ^ (~b[y + 0] & b[y + 1]);
+        CHI_ROW(0) CHI_ROW(5) CHI_ROW(10) CHI_ROW(15) CHI_ROW(20)
+#undef CHI_ROW
+
+        // Iota
+        a[0] ^= roundConstants[round];
+    }
+}
+
+static inline uint64_t loadLane(const uint8_t* p) {
+    uint64_t v = 0;
+    for(int i = 7;i >= 0;i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+void Keccak256(const uint8_t *data, size_t length, uint8_t out[32]) {
+    // 1088 bit rate, 512 bit capacity
+    const size_t rate = 136;
+    uint64_t state[25] = {};
+
+    for(;length >= rate;data += rate, length -= rate) {
+        for(size_t i = 0;i < rate / 8;i++)
+            state[i] ^= loadLane(data + 8 * i);
+        permute(state);
+    }
+
+    uint8_t last[rate] = {};
+    memcpy(last, data, length);
+    last[length] ^= 0x01;
+    last[rate - 1] ^= 0x80;
+    for(size_t i = 0;i < rate / 8;i++)
+        state[i] ^= loadLane(last + 8 * i);
+    permute(state);
+
+    for(size_t i = 0;i < 32;i++)
+        out[i] = (uint8_t)(state[i / 8] >> (8 * (i % 8)));
+}
+
+uint256 Keccak256(const uint8_t *data, size_t length) {
+    uint8_t out[32];
+    Keccak256(data, length, out);
+    return uint256::FromBigEndian(out, 32);
+}
+
+static std::string canonicalType(const std::string& name) {
+    if(name == "uint") return "uint256";
+    if(name == "int") return "int256";
+    if(name == "byte") return "bytes1";
+    if(name == "fixed") return "fixed128x18";
+    if(name == "ufixed") return "ufixed128x18";
+    return name;
+}
+
+static void skipSpace(const std::string& s, size_t& i) {
+    while(i < s.size() && isspace((unsigned char)s[i]))
+        i++;
+}
+
+static std::string readWord(const std::string& s, size_t& i) {
+    auto start = i;
+    while(i < s.size() && (isalnum((unsigned char)s[i]) || s[i] == '_' || s[i] == '$'))
+        i++;
+    return s.substr(start, i - start);
+}
+
+// Reads a parenthesized type list at s[i], which must be '(', into out
+static void canonicalList(const std::string& s, size_t& i, std::string& out) {
+    out += '(';
+    i++;
+    for(bool isFirst = true;;isFirst = false) {
+        skipSpace(s, i);
+        if(i >= s.size())
+            break;
+        if(s[i] == ')') {
+            i++;
+            break;
+        }
+        if(s[i] == ',') {
+            i++;
+            skipSpace(s, i);
+        }
+        if(!isFirst)
+            out += ',';
+
+        if(i < s.size() && s[i] == '(')
+            canonicalList(s, i, out);
+        else
+            out += canonicalType(readWord(s, i));
+
+        // Array suffixes, then any name or data location, up to the next
+        // parameter
+        for(skipSpace(s, i);i < s.size() && s[i] == '[';skipSpace(s, i)) {
+            while(i < s.size() && s[i] != ']') {
+                if(!isspace((unsigned char)s[i]))
+                    out += s[i];
+                i++;
+            }
+            if(i < s.size()) {
+                out += ']';
+                i++;
+            }
+        }
+        while(i < s.size() && s[i] != ',' && s[i] != ')') {
+            if(readWord(s, i).empty())
+                i++;
+        }
+    }
+    out += ')';
+}
+
+std::string CanonicalSignature(const std::string &signature) {
+    size_t i = 0;
+    skipSpace(signature, i);
+    auto rtn = readWord(signature, i);
+    skipSpace(signature, i);
+    if(i < signature.size() && signature[i] == '(')
+        canonicalList(signature, i, rtn);
+    return rtn;
+}
+
+uint32_t FunctionSelector(const std::string &signature) {
+    auto canonical = CanonicalSignature(signature);
+    uint8_t hash[32];
+    Keccak256((const uint8_t*)canonical.data(), canonical.size(), hash);
+    return ((uint32_t)hash[0] << 24) | ((uint32_t)hash[1] << 16) | ((uint32_t)hash[2] << 8) | hash[3];
+}
+
+std::vector<uint32_t> FunctionSelectors(const std::vector<std::string> &signatures) {
+    std::vector<uint32_t> rtn;
+    rtn.reserve(signatures.size());
+    for(auto& signature : signatures)
+        rtn.push_back(FunctionSelector(signature));
+    return rtn;
+}
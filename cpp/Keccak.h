@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "uint256.h"
+
+/***
+ * Keccak-256 as the EVM's SHA3 computes it: the original Keccak padding,
+ * not the one FIPS 202 settled on, so it differs from SHA3-256.
+ */
+void Keccak256(const uint8_t* data, size_t length, uint8_t out[32]);
+uint256 Keccak256(const uint8_t* data, size_t length);
+
+// The signature as it is hashed: no whitespace or parameter names, and
+// uint, int, byte, fixed and ufixed spelled out.
+// "transfer(address to, uint value)" gives "transfer(address,uint256)".
+std::string CanonicalSignature(const std::string& signature);
+
+// First four bytes of the hash of the canonical signature
+uint32_t FunctionSelector(const std::string& signature);
+// Same, for a whole list
+std::vector<uint32_t> FunctionSelectors(const std::vector<std::string>& signatures);
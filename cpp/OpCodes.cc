@@ -1,197 +1,59 @@
 #include "OpCodes.h"
 #include <iostream>
-#include <cmath>
-#include <memory>
-#include <map>
 #include <sstream>
-#include <cstring>
 #include "assert.h"
 
 
-#define XX(NAME, OPCODE, STACKREQ, STACKADD, BYTE_LENGTH) \
-const OpCodes::OpCode OpCodes::NAME(OPCODE, #NAME, STACKREQ, STACKADD, BYTE_LENGTH);
-#include "opcodes_xx.h"
-
-std::map<size_t, std::unique_ptr<OpCodes::OpCode>> unknownOpCodes;
-
-const OpCodes::OpCode& OpCodes::get(uint8_t opCode) {
-    switch(opCode) {
-#define XX(NAME, OPCODE, STACKREQ, STACKADD, BYTE_LENGTH) \
-case OPCODE: { \
-return NAME;\
-break;\
-}
-#include "opcodes_xx.h"
-        default: {
-            if(unknownOpCodes[opCode] == 0) {
-                std::stringstream ss;
-                ss << "UNKNOWN(";
-                ss.width(2);
-                ss.fill('0');
-                ss << std::hex << (uint32_t)opCode << ")";
-                unknownOpCodes[opCode] = std::make_unique<OpCodes::OpCode>(opCode, ss.str());
-            }
-            return *unknownOpCodes[opCode];
-            //std::cerr << "Unknown opcode: 0x" << std::hex << (uint32_t)opCode << std::endl;
-            //assert(false);
-        }
-    }
-
-}
-
-OpCodes::OpCode::OpCode(uint8_t opMode, const std::string &name, size_t stackRemoved, size_t stackAdded, size_t length)
-        : opCode(
-        opMode), name(name), stackRemoved(stackRemoved), stackAdded(stackAdded), length(length) {}
-
-bool OpCodes::OpCode::isBranch() const {
-    return opCode == OpCodes::JUMP.opCode ||
-           opCode == OpCodes::JUMPI.opCode;
-}
-
-bool OpCodes::OpCode::operator==(const OpCodes::OpCode &rhs) const {
-    return opCode == rhs.opCode;
-}
-
-bool OpCodes::OpCode::operator!=(const OpCodes::OpCode &rhs) const {
-    return !(rhs == *this);
-}
-
-static int classNum(uint8_t opCode, const OpCodes::OpCode& start,
-                    const OpCodes::OpCode& end) {
-    if(opCode >= start.opCode &&
-       opCode <= end.opCode)
-        return opCode - start.opCode;
+static int classNum(uint8_t opCode, uint8_t start, uint8_t end) {
+    if(opCode >= start &&
+       opCode <= end)
+        return opCode - start;
     return -1;
 }
 
 int OpCodes::OpCode::dupNum() const {
-    return classNum(opCode, OpCodes::DUP1, OpCodes::DUP16);
+    return classNum(opCode, OP_DUP1, OP_DUP16);
 }
 
 int OpCodes::OpCode::swapNum() const {
-    return classNum(opCode, OpCodes::SWAP1, OpCodes::SWAP16);
+    return classNum(opCode, OP_SWAP1, OP_SWAP16);
 }
 
 int OpCodes::OpCode::pushNum() const {
-    return classNum(opCode, OpCodes::PUSH1, OpCodes::PUSH32);
-}
-
-bool OpCodes::OpCode::isArithmetic() const {
-    if(isUnknown())
-        return false;
-    if(opCode == OP_EXP)
-        return false; // It will overflow
-    if(opCode == OP_SIGNEXTEND)
-        return false;
-    if(opCode >= OpCodes::OP_ADD && opCode < OpCodes::OP_BYTE)
-        return true;
-
-    return false;
+    return classNum(opCode, OP_PUSH1, OP_PUSH32);
 }
 
-static int64_t iexp(int64_t a, int64_t b) {
-    if(b == 0)
-        return 1;
-    if(b == 1)
-        return a;
-
-    auto hb = b / 2;
-
-    auto rtn = iexp(a, hb);
-    if(b % 1)
-        rtn *= a;
-    return rtn;
-}
-
-int64_t OpCodes::OpCode::Solve(const std::vector<int64_t> &input) const {
+uint256 OpCodes::OpCode::Solve(const uint256 *input) const {
     assert(isArithmetic());
     switch(opCode) {
-        case OP_EXP:
-            assert(input.size() == 2);
-            return iexp(input[0], input[1]);
-        case OP_DIV:
-            assert(input.size() == 2);
-            if(input[1] == 0)
-                return 0;
-            return input[0] / input[1];
-        case OP_NOT:
-            assert(input.size() == 1);
-            return ~input[0];
-        case OP_ISZERO:
-            assert(input.size() == 1);
-            return input[0] == 0;
-        case OP_SUB:
-            assert(input.size() == 2);
-            return input[0] - input[1];
-        case OP_AND:
-            assert(input.size() == 2);
-            return input[0] & input[1];
-        case OP_ADD:
-            assert(input.size() == 2);
-            return input[0] + input[1];
-        case OP_GT:
-            assert(input.size() == 2);
-            return input[0] > input[1];
-        case OP_LT:
-            assert(input.size() == 2);
-            return input[0] > input[1];
-        case OP_XOR:
-            assert(input.size() == 2);
-            return input[0] ^ input[1];
-        case OP_MUL:
-            assert(input.size() == 2);
-            return input[0] * input[1];
-        case OP_MOD:
-            assert(input.size() == 2);
-            return input[0] % input[1];
-        case OP_EQ:
-            assert(input.size() == 2);
-            return input[0] == input[1];
-        case OP_SDIV:
-            assert(input.size() == 2);
-            if(input[1] == 0)
-                return 0;
-            return input[0] / input[1];
+        case OP_ADD: return input[0] + input[1];
+        case OP_MUL: return input[0] * input[1];
+        case OP_SUB: return input[0] - input[1];
+        case OP_DIV: return input[0] / input[1];
+        case OP_SDIV: return evm::sdiv(input[0], input[1]);
+        case OP_MOD: return input[0] % input[1];
+        case OP_SMOD: return evm::smod(input[0], input[1]);
+        case OP_ADDMOD: return evm::addmod(input[0], input[1], input[2]);
+        case OP_MULMOD: return evm::mulmod(input[0], input[1], input[2]);
+        case OP_EXP: return evm::exp(input[0], input[1]);
+        case OP_SIGNEXTEND: return evm::signextend(input[0], input[1]);
+        case OP_LT: return input[0] < input[1];
+        case OP_GT: return input[0] > input[1];
+        case OP_SLT: return evm::slt(input[0], input[1]);
+        case OP_SGT: return evm::sgt(input[0], input[1]);
+        case OP_EQ: return input[0] == input[1];
+        case OP_ISZERO: return input[0].IsZero();
+        case OP_AND: return input[0] & input[1];
+        case OP_OR: return input[0] | input[1];
+        case OP_XOR: return input[0] ^ input[1];
+        case OP_NOT: return ~input[0];
+        case OP_BYTE: return evm::byte(input[0], input[1]);
+        case OP_SHL: return evm::shl(input[0], input[1]);
+        case OP_SHR: return evm::shr(input[0], input[1]);
+        case OP_SAR: return evm::sar(input[0], input[1]);
         default:
             throw std::runtime_error(std::string("Don't have the logic enabled for ") + name);
     }
-    return 0;
-}
-
-bool OpCodes::OpCode::isStackManipulatorOnly() const {
-    if(swapNum() != -1)
-            return true;
-    if(dupNum() != -1)
-            return true;
-    if(pushNum() != -1)
-            return true;
-    switch(opCode) {
-            case OP_POP:
-                    return true;
-                default:
-                    return false;
-            }
-}
-
-bool OpCodes::OpCode::isStop() const {
-    return opCode == OP_STOP ||
-           opCode == OP_RETURN ||
-           opCode == OP_INVALID ||
-           opCode == OP_SUICIDE;
-}
-
-bool OpCodes::OpCode::isFallThrough() const {
-    if(isStop())
-        return false;
-
-    if(opCode == OP_JUMP)
-        return false;
-
-    return true;
-}
-
-bool OpCodes::OpCode::isUnknown() const {
-    return strncmp(name.c_str(), "UNKNOWN", strlen("UNKNOWN") - 1) == 0;
 }
 
 std::string OpCodes::OpCode::Infix() const {
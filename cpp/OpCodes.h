@@ -1,50 +1,149 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <array>
 #include <string>
+#include <utility>
 #include <vector>
 #include <assert.h>
+#include "uint256.h"
 
 namespace OpCodes {
+    // Precomputed properties, so each predicate is a single load and mask
+    enum OpCodeFlags : uint16_t {
+        FLAG_BRANCH = 1 << 0,
+        FLAG_STOP = 1 << 1,
+        FLAG_FALL_THROUGH = 1 << 2,
+        FLAG_ARITHMETIC = 1 << 3,
+        FLAG_STACK_ONLY = 1 << 4,
+        FLAG_UNKNOWN = 1 << 5,
+        FLAG_CLOBBERS_MEMORY = 1 << 6,
+    };
+
     struct OpCode {
         uint8_t opCode;
-        std::string name;
-        size_t stackRemoved, stackAdded, length;
+        uint8_t stackRemoved, stackAdded, length;
+        uint16_t flags;
+        const char* name;
 
-        OpCode(uint8_t opMode, const std::string &name, size_t stackRemoved = 0,
-               size_t stackAdded = 0, size_t length = 0);
+        constexpr OpCode(uint8_t opCode, const char* name, uint8_t stackRemoved,
+                         uint8_t stackAdded, uint8_t length, uint16_t flags)
+                : opCode(opCode), stackRemoved(stackRemoved), stackAdded(stackAdded),
+                  length(length), flags(flags), name(name) {}
 
         OpCode& operator=(const OpCode&) = delete;
         OpCode(const OpCode&) = delete;
 
-        bool isFallThrough() const;
-        bool isBranch() const;
-        bool isUnknown() const;
+        bool isFallThrough() const { return flags & FLAG_FALL_THROUGH; }
+        bool isBranch() const { return flags & FLAG_BRANCH; }
+        bool isUnknown() const { return flags & FLAG_UNKNOWN; }
         int dupNum() const;
         int swapNum() const;
         int pushNum() const;
 
         std::string Infix() const;
 
-        bool isStop() const;
-        bool isStackManipulatorOnly() const;
-        bool isArithmetic() const;
+        bool isStop() const { return flags & FLAG_STOP; }
+        bool isStackManipulatorOnly() const { return flags & FLAG_STACK_ONLY; }
+        bool isArithmetic() const { return flags & FLAG_ARITHMETIC; }
+        // Writes memory other than the one word or byte MSTORE and MSTORE8
+        // do, so whatever was known to be stored may be gone. Unknown
+        // opcodes, RETURNDATACOPY and STATICCALL among them, are taken to.
+        bool clobbersMemory() const { return flags & FLAG_CLOBBERS_MEMORY; }
 
-        int64_t Solve(const std::vector<int64_t>& input) const;
+        // Folds an arithmetic op over constant operands, top of stack first
+        uint256 Solve(const uint256* input) const;
 
-        bool operator==(const OpCode &rhs) const;
+        bool operator==(const OpCode &rhs) const { return opCode == rhs.opCode; }
 
-        bool operator!=(const OpCode &rhs) const;
+        bool operator!=(const OpCode &rhs) const { return !(rhs == *this); }
     };
+    static_assert(sizeof(OpCode) == 16, "OpCode table entries should stay 16 bytes");
 
 #define XX(NAME, OPCODE, STACKREQ, STACKADD, BYTE_LENGTH) \
-    extern const OpCode NAME;\
     static const uint8_t OP_ ## NAME = OPCODE;
 #include "opcodes_xx.h"
 
-    extern const OpCode UNKNOWN;
+    namespace detail {
+        // Every byte has a name; the ones opcodes_xx.h leaves out are 'UNKNOWN(xx)'
+        struct NameTable {
+            char names[256][16];
+        };
+
+        constexpr void copyName(char* dest, const char* src) {
+            while((*dest++ = *src++));
+        }
+
+        constexpr NameTable makeNameTable() {
+            NameTable t = {};
+            const char* hex = "0123456789abcdef";
+            for(size_t i = 0;i < 256;i++) {
+                copyName(t.names[i], "UNKNOWN(xx)");
+                t.names[i][8] = hex[i >> 4];
+                t.names[i][9] = hex[i & 0xf];
+            }
+#define XX(NAME, OPCODE, STACKREQ, STACKADD, BYTE_LENGTH) \
+            copyName(t.names[OPCODE], #NAME);
+#include "opcodes_xx.h"
+            return t;
+        }
+
+        inline constexpr NameTable nameTable = makeNameTable();
+
+        constexpr bool inRange(uint8_t opCode, uint8_t first, uint8_t last) {
+            return opCode >= first && opCode <= last;
+        }
+
+        constexpr uint16_t makeFlags(uint8_t opCode, bool isUnknown) {
+            uint16_t flags = 0;
+            if(isUnknown)
+                flags |= FLAG_UNKNOWN;
+            if(opCode == OP_JUMP || opCode == OP_JUMPI)
+                flags |= FLAG_BRANCH;
+            if(opCode == OP_STOP || opCode == OP_RETURN || opCode == OP_INVALID || opCode == OP_SUICIDE)
+                flags |= FLAG_STOP;
+            if(!(flags & FLAG_STOP) && opCode != OP_JUMP)
+                flags |= FLAG_FALL_THROUGH;
+            if(!isUnknown && opCode >= OP_ADD && opCode <= OP_SAR)
+                flags |= FLAG_ARITHMETIC;
+            if(inRange(opCode, OP_SWAP1, OP_SWAP16) || inRange(opCode, OP_DUP1, OP_DUP16) ||
+               inRange(opCode, OP_PUSH1, OP_PUSH32) || opCode == OP_POP)
+                flags |= FLAG_STACK_ONLY;
+            if(isUnknown || opCode == OP_CALLDATACOPY || opCode == OP_CODECOPY || opCode == OP_EXTCODECOPY ||
+               opCode == OP_CALL || opCode == OP_CALLCODE || opCode == OP_DELEGATECALL)
+                flags |= FLAG_CLOBBERS_MEMORY;
+            return flags;
+        }
 
-    const OpCode& get(uint8_t opCode);
+        constexpr OpCode makeOpCode(uint8_t opCode) {
+            switch(opCode) {
+#define XX(NAME, OPCODE, STACKREQ, STACKADD, BYTE_LENGTH) \
+                case OPCODE: \
+                    return OpCode(OPCODE, nameTable.names[OPCODE], STACKREQ, STACKADD, BYTE_LENGTH, \
+                                  makeFlags(OPCODE, false));
+#include "opcodes_xx.h"
+                default:
+                    return OpCode(opCode, nameTable.names[opCode], 0, 0, 0, makeFlags(opCode, true));
+            }
+        }
+
+        template <size_t... I>
+        constexpr std::array<OpCode, sizeof...(I)> makeTable(std::index_sequence<I...>) {
+            return {{ makeOpCode(I)... }};
+        }
+
+        // 16 bytes an entry, four to a cache line
+        alignas(64) inline constexpr std::array<OpCode, 256> table = makeTable(std::make_index_sequence<256>());
+    }
+
+#define XX(NAME, OPCODE, STACKREQ, STACKADD, BYTE_LENGTH) \
+    inline constexpr const OpCode& NAME = detail::table[OPCODE];
+#include "opcodes_xx.h"
+
+    inline const OpCode& get(uint8_t opCode) {
+        return detail::table[opCode];
+    }
 
     template <typename F>
     void iterate(const std::vector<uint8_t>& bc, F f) {
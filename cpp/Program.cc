@@ -4,13 +4,18 @@
 
 #include <set>
 #include <iostream>
+#include <mutex>
+#include <unordered_set>
 #include "Program.h"
 #include "Utils.h"
 #include "OpCodes.h"
 #include "CFInstruction.h"
+#include "AnalysisCache.h"
+#include "Keccak.h"
+#include "AuditEngine.h"
 
 static void printOpCode(const uint8_t* data, size_t pos, const OpCodes::OpCode& opCode) {
-    printf("\t%4lu (0x%04lx): %s", pos, pos, opCode.name.c_str());
+    printf("\t%4lu (0x%04lx): %s", pos, pos, opCode.name);
     for(size_t i = 0;i < opCode.length;i++) {
         printf(" %02x", data[i]);
     }
@@ -18,351 +23,326 @@ static void printOpCode(const uint8_t* data, size_t pos, const OpCodes::OpCode&
 }
 
 
+/***
+ * What a straight line run of instructions wrote to memory with constant
+ * addresses, so SHA3 over constant words (the slot of a mapping entry with
+ * a constant key, say) can be folded. Anything not written since the last
+ * Clear is unknown, even though memory starts out zeroed, since some other
+ * path may have written it.
+ */
+class ConstantMemory {
+    struct Write {
+        int64_t offset;
+        size_t length;
+        bool isKnown;
+        uint8_t bytes[32];
+    };
+    std::vector<Write> writes;
+public:
+    // Longest SHA3 input that is folded
+    static const int64_t MAX_READ = 1024;
+
+    void Clear() { writes.clear(); }
+
+    // The low length bytes of value, or unknown ones if value is null
+    void Store(int64_t offset, size_t length, const uint256* value) {
+        Write write = { offset, length, value != nullptr, {} };
+        if(value) {
+            uint8_t word[32];
+            value->ToBigEndian(word);
+            std::copy(word + 32 - length, word + 32, write.bytes);
+        }
+        writes.push_back(write);
+    }
+
+    // Fills out if every byte of [offset, offset + size) is known
+    bool Read(int64_t offset, int64_t size, std::vector<uint8_t>& out) const {
+        if(offset < 0 || size < 0 || size > MAX_READ)
+            return false;
+        out.assign(size, 0);
+        std::vector<bool> isKnown(size);
+        for(auto& write : writes) {
+            auto first = std::max(offset, write.offset);
+            auto last = std::min(offset + size, write.offset + (int64_t)write.length);
+            for(auto at = first;at < last;at++) {
+                out[at - offset] = write.bytes[at - write.offset];
+                isKnown[at - offset] = write.isKnown;
+            }
+        }
+        return std::all_of(isKnown.begin(), isKnown.end(), [](bool b) { return b; });
+    }
+};
+
+CFExpression Program::newOutput(size_t &globalIdx, size_t pos, const OpCodes::OpCode &opCode) {
+    // Every output takes a symbol number, even the ones that turn out constant
+    auto idx = globalIdx++;
+    if(opCode.pushNum() != -1) {
+        assert(opCode.length);
+        return expressions.Constant(uint256::FromBigEndian(&byteCode[pos + 1], opCode.length), opCode.length);
+    }
+    return CFExpression::Symbol(idx);
+}
+
+void Program::foldMemory(ConstantMemory &memory, const OpCodes::OpCode &opCode, Span<const CFExpression> operands,
+                         Span<CFExpression> outputs) {
+    int64_t offset = 0, size = 0;
+    bool isConstantOffset = !operands.empty() && expressions.GetConstantInt(operands[0], &offset);
+    switch(opCode.opCode) {
+        case OpCodes::OP_MSTORE:
+        case OpCodes::OP_MSTORE8:
+            if(!isConstantOffset) {
+                memory.Clear();
+            } else {
+                memory.Store(offset, opCode.opCode == OpCodes::OP_MSTORE ? 32 : 1,
+                             operands[1].isConstant() ? &expressions.Value(operands[1]) : nullptr);
+            }
+            break;
+        case OpCodes::OP_SHA3: {
+            std::vector<uint8_t> input;
+            if(isConstantOffset && expressions.GetConstantInt(operands[1], &size) && memory.Read(offset, size, input))
+                outputs[0] = expressions.Constant(Keccak256(input.data(), input.size()));
+            break;
+        }
+        default:
+            if(opCode.clobbersMemory())
+                memory.Clear();
+            break;
+    }
+}
+
 void Program::fillInstructions() {
+    instructions.Build(byteCode);
+
     std::vector<CFExpression> stack;
+    ConstantMemory memory;
     size_t globalIdx = 0;
     size_t* jumpIdx = 0;
-    OpCodes::iterate(byteCode, [&](const uint8_t* data, size_t pos, const OpCodes::OpCode& opCode){
-        instructions[pos] = std::make_shared<CFInstruction>(*this, pos, opCode);
+    for(size_t idx = 0;idx < instructions.Size();idx++) {
+        auto pos = instructions.Offset(idx);
+        auto& opCode = instructions.OpCodeAt(idx);
+        auto operands = instructions.Operands(idx);
+        auto outputs = instructions.Outputs(idx);
 
         if(opCode.opCode == OpCodes::OP_JUMPDEST) {
             jumpdests[pos] = 0;
             jumpIdx = &jumpdests[pos];
             stack.clear();
+            memory.Clear();
         }
 
-        for(size_t i = 0;i < opCode.length;i++) {
-            instructions[pos]->data.push_back( data[i]);
-        }
-
-        auto stackBack = stack.end();
         for(size_t i = 0;i <opCode.stackRemoved;i++) {
             if(stack.size() == 0) {
-                CFExpression entry;
-                entry.label = "argument";
-                if(jumpIdx)
-                    entry.idx = (*jumpIdx)++;
-                stack.push_back(entry);
+                stack.push_back(CFExpression::Argument(jumpIdx ? (*jumpIdx)++ : 0));
             }
 
-            if(!opCode.isStackManipulatorOnly() && symbols.find(stack.back().idx) != symbols.end()) {
-                symbols[stack.back().idx].usedAt.insert(pos);
-            }
-            instructions[pos]->operands.emplace_back(stack.back());
+            operands[i] = stack.back();
             stack.pop_back();
         }
 
         for(size_t i = 0;i < opCode.stackAdded;i++) {
-            CFExpression entry;
-            entry.idx = globalIdx++;
-            if(opCode.opCode >= OpCodes::PUSH1.opCode &&
-               opCode.opCode <= OpCodes::PUSH32.opCode) {
-                entry.isConstant = true;
-                assert(instructions[pos]->data.size());
-                entry.constantValue = instructions[pos]->data;
-            }
-            instructions[pos]->outputs.emplace_back(entry);
+            outputs[i] = newOutput(globalIdx, pos, opCode);
         }
 
-        instructions[pos]->simplify();
-        for (auto it = instructions[pos]->outputs.rbegin();
-             it != instructions[pos]->outputs.rend();it++) {
-            if(it->label.empty() && !it->isConstant && symbols.find(it->idx) == symbols.end()) {
-                symbols[it->idx].idx = it->idx;
-                symbols[it->idx].createdAt = pos;
+        CFInstruction::simplify(expressions, opCode, operands, outputs);
+        foldMemory(memory, opCode, operands, outputs);
+        for (size_t i = outputs.size();i-- > 0;) {
+            auto& output = outputs[i];
+            if(output.isSymbolic() && symbols.find(output.idx()) == symbols.end()) {
+                symbols[output.idx()].idx = output.idx();
+                symbols[output.idx()].createdAt = pos;
             }
-            stack.push_back(*it);
+            stack.push_back(output);
         }
-
-    });
+    }
 }
 
 void Program::initGraph() {
-    size_t idx = 1;
     CFNode currNode;
+    bool inNode = false;
 
-    for(auto& inst : instructions) {
-        auto& instruction = *inst.second;
-        if(currNode.start == (size_t)-1){
+    for(auto instruction : Instructions()) {
+        if(instruction.opCode == OpCodes::JUMPDEST && inNode) {
+            graph.Add(currNode);
+            inNode = false;
+        }
+
+        if(!inNode) {
+            currNode = CFNode();
             currNode.start = instruction.offset;
+            currNode.first = instruction.index;
+            currNode.isJumpDest = instruction.opCode == OpCodes::JUMPDEST;
+            inNode = true;
         }
         currNode.end = instruction.offset + 1 + instruction.opCode.length;
+        currNode.last = instruction.index + 1;
+
         if(instruction.opCode.isBranch() ||
                 instruction.opCode.isStop()) {
-            nodes[currNode.start] = std::make_shared<CFNode>(currNode);
-            currNode = CFNode();
-            currNode.start = currNode.end = (size_t)-1;
-            currNode.idx = idx++;
-        } else if(instruction.opCode == OpCodes::JUMPDEST) {
-            if(currNode.end - currNode.start == 0) {
-                currNode.isJumpDest = true;
-            } else {
-                currNode.end--;
-                nodes[currNode.start] = std::make_shared<CFNode>(currNode);
-                currNode = CFNode();
-                currNode.start = currNode.end = instruction.offset;
-                currNode.isJumpDest = true;
-                currNode.idx = idx++;
-            }
+            graph.Add(currNode);
+            inNode = false;
         }
     }
 
-    if(currNode.start != -1 && currNode.end != currNode.start) {
-        nodes[currNode.start] = std::make_shared<CFNode>(currNode);
+    if(inNode) {
+        graph.Add(currNode);
     }
+    graph.Finalize();
 }
 
-void Program::startGraph() {
-    std::set< size_t > seen;
-    std::vector< size_t > todo;
+size_t Program::addJump(size_t from, size_t issueOffset, int64_t target) {
+    auto to = graph.IndexAt((size_t)target);
+    if(to == CFGraph::npos)
+        return CFGraph::npos;
 
-    for(auto& n : nodes) {
-        todo.push_back(n.first);
+    if(graph[to].isJumpDest) {
+        graph.AddEdge(from, to);
+        return to;
     }
 
-    while(!todo.empty()) {
-        auto pos = todo.back(); todo.pop_back();
+    addInvalidJump(from, issueOffset, to);
+    return CFGraph::npos;
+}
 
-        if(seen.find(pos) != seen.end())
-            continue;
-        seen.insert(pos);
+void Program::addInvalidJump(size_t from, size_t issueOffset, size_t to) {
+    // The solver can reach the same jump many times
+    if(invalidJumps.insert(std::make_pair(issueOffset, to)).second)
+        this->AddIssue(issueOffset, "Invalid jump from " + std::to_string(from) + " to " + std::to_string(to));
+}
 
-        auto node = GetNodeExactlyAt(pos);
-        assert(node);
-        auto lastInstr = node->lastInstruction(*this);
+void Program::startGraph() {
+    for(size_t i = 0;i < graph.Size();i++) {
+        auto& node = graph[i];
+        auto lastInstr = node.lastInstruction(*this);
         assert(lastInstr);
+        if(!lastInstr)
+            continue;
 
         if( lastInstr->opCode.isFallThrough()) {
-            auto& next = nodes[ node->end];
-            if(next) {
-                node->AddNext(next);
+            auto next = graph.IndexAt(node.end);
+            if(next != CFGraph::npos) {
+                graph.AddEdge(i, next);
             }
         }
 
         if( lastInstr->opCode.opCode == OpCodes::OP_JUMPI ||
                 lastInstr->opCode.opCode == OpCodes::OP_JUMP) {
             assert(!lastInstr->operands.empty());
-            auto& jumpTo = lastInstr->operands.front();
             int64_t nextAddr = 0;
-            if(jumpTo.isConstant && getInt64FromVec(jumpTo.constantValue, &nextAddr)) {
-                if(auto next = GetNodeExactlyAt(nextAddr)) {
-                    //assert(next->isJumpDest);
-                    if(next->isJumpDest)
-                        node->AddNext(next);
-                    else
-                        this->AddIssue(pos, "Invalid jump from " + std::to_string(node->idx) + " to " + std::to_string(next->idx));
-                }
+            if(expressions.GetConstantInt(lastInstr->operands.front(), &nextAddr)) {
+                addJump(i, node.start, nextAddr);
             }
         }
-
-    }
-}
-
-void Program::solveStack(size_t& globalIdx,
-                         std::shared_ptr<CFNode> node,
-                         std::shared_ptr<CFNode> pnode) {
-    std::map< CFStack, std::vector<executionPath> >& possibleStackStarts =
-            node->possibleEntryStackStates;
-
-    if(pnode) {
-        for(auto& s : pnode->possibleExitStackStates) {
-            auto path = s.second;
-            for(auto& p : path) {
-                p.push_back(pnode->idx);
-                possibleStackStarts[s.first].push_back(p);
-            }
-        }
-    }
-    else {
-        assert(node->idx == 0);
-        CFStack empty;
-        possibleStackStarts[empty].emplace_back();
-    }
-
-    auto nodeInstructions = node->Instructions(*this);
-    size_t argumentIdx = 0;
-    for(auto& _possibleStackStart : possibleStackStarts) {
-        auto stack = _possibleStackStart.first;
-
-        for(auto& instruction : nodeInstructions) {
-            auto& opCode = instruction->opCode;
-            auto pos = instruction->offset;
-
-            auto oldOperands = instruction->operands;
-            auto oldOutputs = instruction->outputs;
-
-            instruction->operands.clear();
-            instruction->outputs.clear();
-
-            auto stackBack = stack.end();
-            for (size_t i = 0; i < opCode.stackRemoved; i++) {
-                if(stack.size() == 0) {
-                    CFExpression entry;
-                    entry.label = "argument";
-                    entry.idx = argumentIdx++;
-                    stack.push_back(entry);
-                }
-
-                instruction->operands.emplace_back(stack.back());
-                stack.pop_back();
-            }
-
-            for (size_t i = 0; i < opCode.stackAdded; i++) {
-                CFExpression entry;
-                entry.idx = globalIdx++;
-                if (opCode.opCode >= OpCodes::PUSH1.opCode &&
-                    opCode.opCode <= OpCodes::PUSH32.opCode) {
-                    entry.isConstant = true;
-                    assert(instruction->data.size());
-                    entry.constantValue = instruction->data;
-                }
-                instruction->outputs.emplace_back(entry);
-            }
-
-            instruction->simplify();
-            for (auto it = instruction->outputs.rbegin();
-                    it != instruction->outputs.rend();it++) {
-                stack.push_back(*it);
-            }
-
-            int64_t jumpLoc = 0;
-            if(instruction->opCode.isBranch() &&
-               !instruction->operands.empty() &&
-               instruction->operands.front().isConstant &&
-               getInt64FromVec(instruction->operands.front().constantValue, &jumpLoc)) {
-                if(auto jumpNode = GetNodeExactlyAt(jumpLoc)) {
-                    //assert(jumpNode->isJumpDest);
-                    if(jumpNode->isJumpDest)
-                        node->AddNext(jumpNode);
-                    else
-                        this->AddIssue(pos, "Invalid jump from " + std::to_string(node->idx) + " to " + std::to_string(jumpNode->idx));
-                }
-            }
-
-            instruction->operands = oldOperands;
-            instruction->outputs = oldOutputs;
-        }
-
-
-        for(auto& p : _possibleStackStart.second)
-            node->possibleExitStackStates[stack].push_back(p);
     }
+    graph.Finalize();
 }
 
 bool Program::solveStack() {
-    typedef std::pair< std::shared_ptr<CFNode>,
-            std::shared_ptr<CFNode> > NodePair;
-    std::set< NodePair > seen;
-    std::vector< NodePair > todo;
-    size_t globalIdx = 0;
-
-    if(nodes.empty() || nodes[0] == nullptr)
+    if(graph.Empty())
         return false;
 
-    todo.emplace_back(nodes[0], nullptr);
-    while(!todo.empty()) {
-        auto pos = todo.back();
-        todo.pop_back();
-
-        if (seen.find(pos) != seen.end())
-            continue;
-        seen.insert(pos);
-
-        auto node = pos.first;
-        assert(node);
-
-        solveStack(globalIdx, node, pos.second);
-
-        for(auto& n : node->NextNodes()) {
-            assert(n);
-                todo.emplace_back(n, node);
-        }
-    }
-
+    auto before = budget->Used();
+    if(!StackSolver(*this, options).Solve())
+        truncate();
+    budgetSpent = budget->Used() - before;
+    graph.Finalize();
     return true;
 }
 
-Program::Program(const std::vector<uint8_t> &byteCode) : byteCode(byteCode) {
+Program::Program(const std::vector<uint8_t> &byteCode, const AnalysisCache* cache, const SolverOptions& options)
+        : Program(byteCode, cache, options, std::make_shared<AnalysisBudget>(options.budget)) {}
+
+Program::Program(const std::vector<uint8_t> &byteCode, const AnalysisCache* cache, const SolverOptions& options,
+                 std::shared_ptr<AnalysisBudget> budget)
+        : byteCode(byteCode), cache(cache), options(options), budget(std::move(budget)) {
     fillInstructions();
     initGraph();
     startGraph();
     solveStack();
+    analysis = GraphAnalysis(graph);
+    ssa = SSAForm(*this);
+    taint = TaintAnalysis(*this);
+    functions = FunctionTable(*this);
 
     findCreatedContracts();
 }
 
-void Program::print(bool showStackOps, bool showUnreachable) {
-    std::cout << DisassemReport(*this, showStackOps, showUnreachable);
+void Program::print(std::ostream& os, bool showStackOps, bool showUnreachable) const {
+    os << DisassemReport(*this, showStackOps, showUnreachable);
 
     if(!createdContracts.empty()) {
         for(auto& cc : createdContracts) {
-            std::cout << std::endl << "Can Create contract:" << std::endl;
-            cc->print(showStackOps, showUnreachable);
+            if(!cc)
+                continue;
+            os << std::endl << "Can Create contract:" << std::endl;
+            cc->print(os, showStackOps, showUnreachable);
         }
     }
 }
 
-std::ostream& Program::streamStackStates(std::ostream& os, const std::map<CFStack, std::vector<executionPath> > &stackStates) const {
+std::ostream& Program::streamStackStates(std::ostream& os, const CFStackStates &stackStates) const {
+    // The states are hashed, so sort them by what they print as; the report
+    // must not depend on the hash table's order
+    std::vector<std::string> rendered;
+    rendered.reserve(stackStates.size());
     for(auto& ps : stackStates) {
-            auto& s = ps.first;
-            auto& paths = ps.second;
-
-        os << "For execution paths: ";
-            for(auto& path : paths) {
-                bool isFirst = true;
-                for(auto& node : path) {
-                    if(!isFirst) {
-                        os << "->";
-                    }
-                    isFirst = false;
-                    os << node;
+        auto& s = ps.first;
+        std::stringstream ss;
+        ss << "For execution paths: ";
+        for(auto path : ps.second) {
+            bool isFirst = true;
+            for(auto node : paths.Materialize(path)) {
+                if(!isFirst) {
+                    ss << "->";
                 }
-                os << " ";
-            }
-        os << std::endl;
-            for(int32_t i = s.size() - 1;i >= 0;i--) {
-                os << "\t[";
-                os.width(3); os.fill(' ');
-                os << (s.size() - i - 1) << "]: ";
-                os << s[i] << std::endl;
+                isFirst = false;
+                ss << node;
             }
+            ss << " ";
         }
+        ss << std::endl;
+        for(int32_t i = s.size() - 1;i >= 0;i--) {
+            ss << "\t[";
+            ss.width(3); ss.fill(' ');
+            ss << (s.size() - i - 1) << "]: ";
+            expressions.Stream(ss, s[i]) << std::endl;
+        }
+        rendered.push_back(ss.str());
+    }
+    std::sort(rendered.begin(), rendered.end());
+    for(auto& state : rendered)
+        os << state;
     os << std::endl;
     return os;
 }
 
 void Program::findCreatedContracts() {
-    for(auto& _node : nodes) {
-        auto& node = _node.second;
-        if(!node) continue;
-
-        auto nodeInstructions = node->Instructions(*this);
-        if(!node->IsReachable())
+    for(auto& node : graph) {
+        auto nodeInstructions = node.Instructions(*this);
+        if(!graph.IsReachable(node.idx))
             continue;
 
-        for (auto &instr : nodeInstructions) {
-            if (!instr)
-                continue;
-
-            if (instr->opCode.opCode == OpCodes::OP_CODECOPY && instr->allOperandsConstant()) {
+        for (auto instr : nodeInstructions) {
+            if (instr.opCode.opCode == OpCodes::OP_CODECOPY && instr.allOperandsConstant()) {
                 int64_t mLoc, mOffset, mSize;
                 bool canRead =
-                        getInt64FromVec(instr->operands[0].constantValue, &mLoc) &&
-                        getInt64FromVec(instr->operands[1].constantValue, &mOffset) &&
-                        getInt64FromVec(instr->operands[2].constantValue, &mSize);
-                assert(canRead);
-
-                auto pos = instr->offset;
-                while (pos < instructions.size()) {
-                    auto instr = instructions[pos++];
-                    if (instr && instr->opCode.isStop()) {
-
-                        if (instr->opCode.opCode == OpCodes::OP_RETURN && instr->allOperandsConstant()) {
+                        expressions.GetConstantInt(instr.operands[0], &mLoc) &&
+                        expressions.GetConstantInt(instr.operands[1], &mOffset) &&
+                        expressions.GetConstantInt(instr.operands[2], &mSize);
+                // Folded constants can be wider than 64 bits
+                if (!canRead)
+                    continue;
+
+                for (auto idx = instr.index; idx < instructions.Size(); idx++) {
+                    auto instr = Instruction(idx);
+                    if (instr.opCode.isStop()) {
+
+                        if (instr.opCode.opCode == OpCodes::OP_RETURN && instr.allOperandsConstant()) {
                             int64_t rLoc, rSize;
                             bool canRead =
-                                    getInt64FromVec(instr->operands[0].constantValue, &rLoc) &&
-                                    getInt64FromVec(instr->operands[1].constantValue, &rSize);
-                            assert(canRead);
+                                    expressions.GetConstantInt(instr.operands[0], &rLoc) &&
+                                    expressions.GetConstantInt(instr.operands[1], &rSize);
+                            if (!canRead)
+                                break;
 
                             std::vector<uint8_t> newBC;
                             auto offset = rLoc - mLoc;
@@ -372,9 +352,18 @@ void Program::findCreatedContracts() {
                             }
 
                             if(!newBC.empty()) {
-                                auto contract = std::make_shared<Program>(newBC);
-                                if(contract->IsValid())
-                                    createdContracts.emplace_back(contract);
+                                if(cache && cache->CanRestore(newBC)) {
+                                    createdContracts.emplace_back(nullptr);
+                                    createdByteCodes.emplace_back(newBC);
+                                } else if(budget->IsExhausted()) {
+                                    truncate();
+                                } else {
+                                    std::shared_ptr<Program> contract(new Program(newBC, cache, options, budget));
+                                    if(contract->IsValid()) {
+                                        createdContracts.emplace_back(contract);
+                                        createdByteCodes.emplace_back(newBC);
+                                    }
+                                }
                             }
                         }
 
@@ -387,49 +376,57 @@ void Program::findCreatedContracts() {
     }
 }
 
-Program::~Program() {
-    for(auto& n : nodes) {
-        if(n.second)
-            n.second->ClearNextAndPrev();
+void Program::truncate() {
+    if(isTruncated)
+        return;
+    isTruncated = true;
+    AddIssue(0, "Analysis stopped early: out of budget");
+}
+
+bool Program::IsTruncated() const {
+    if(isTruncated)
+        return true;
+    for(auto& contract : createdContracts) {
+        if(contract && contract->IsTruncated())
+            return true;
     }
+    return false;
 }
 
 bool Program::IsValid() const {
-    if(instructions.empty())
+    if(instructions.Empty())
         return false;
     return true;
 }
 
 void Program::AddIssue(size_t offset, const std::string &msg) {
+    static std::mutex cerrLock;
+
     issues.emplace_back(offset, msg);
-    std::cerr << issues.back() << std::endl;
+
+    // Many programs can be analyzed at once; emit each issue as one line
+    std::stringstream ss;
+    ss << issues.back() << std::endl;
+    std::lock_guard<std::mutex> l(cerrLock);
+    std::cerr << ss.str();
 }
 
-std::shared_ptr<CFNode> Program::GetNode(size_t offset) const {
-    if(offset >= byteCode.size())
+const CFNode* Program::GetNode(size_t offset) const {
+    auto i = graph.IndexContaining(offset);
+    if(i == CFGraph::npos)
         return nullptr;
-
-    auto node = nodes.lower_bound(offset);
-    while(node != nodes.end() && (node->second == nullptr || node->second->start > offset))
-        node--;
-
-    if(node == nodes.end())
-        nullptr;
-
-    assert(node != nodes.end() && node->second &&
-                   node->second->start <= offset && node->second->end >= offset);
-    return node->second;
+    return &graph[i];
 }
 
-std::shared_ptr<CFNode> Program::GetNode(const CFInstruction &instruction) const {
+const CFNode* Program::GetNode(const CFInstruction &instruction) const {
     return GetNode(instruction.offset);
 }
 
-std::shared_ptr<CFNode> Program::GetNodeExactlyAt(size_t offset) const {
-    auto it = nodes.find(offset);
-    if(it != nodes.end())
-        return it->second;
-    return nullptr;
+const CFNode* Program::GetNodeExactlyAt(size_t offset) const {
+    auto i = graph.IndexAt(offset);
+    if(i == CFGraph::npos)
+        return nullptr;
+    return &graph[i];
 }
 
 std::ostream &operator<<(std::ostream &os, const ProgramReport &report) {
@@ -444,23 +441,21 @@ DisassemReport::DisassemReport(const Program &program, bool shouldPrintStackOps,
 
 std::ostream &DisassemReport::Stream(std::ostream &os) const {
     os << "entry:" << std::endl;
-    for(auto& pr : program.Nodes()) {
-        auto& node = pr.second;
-        if(!node)
-            continue;
-
-        if(!node->IsReachable() && !shouldShowUnreachable)
+    auto& graph = program.Graph();
+    for(auto& node : graph) {
+        bool isReachable = graph.IsReachable(node.idx);
+        if(!isReachable && !shouldShowUnreachable)
             continue;
 
-        if(node->isJumpDest) {
-            os << "loc_" << std::dec << node->idx << ": " << std::endl;
+        if(node.isJumpDest) {
+            os << "loc_" << std::dec << node.idx << ": " << std::endl;
         } else {
-            os << "/* Block " << std::dec << node->idx << "*/" << std::endl;
+            os << "/* Block " << std::dec << node.idx << "*/" << std::endl;
         }
-        if(!node->IsReachable() && node->hasUnknownOpCodes(program)) {
+        if(!isReachable && node.hasUnknownOpCodes(program)) {
             os << "/* Possible data section: */" << std::endl;
-            for(auto i = node->start;i < node->end;i++ ) {
-                if((i - node->start) % 16 == 0 && i != node->start)
+            for(auto i = node.start;i < node.end;i++ ) {
+                if((i - node.start) % 16 == 0 && i != node.start)
                     os << std::endl;
                 os.fill('0');
                 os.width(2);
@@ -470,31 +465,28 @@ std::ostream &DisassemReport::Stream(std::ostream &os) const {
             continue;
         }
 
-        if(!node->IsReachable()) {
+        if(!isReachable) {
             os << "/* Unreachable*/" << std::endl;
-        } else if(!node->PrevNodes().empty()){
+        } else if(!graph.Prev(node.idx).empty()){
             os << "/* Reachable from ";
-            for(auto& n : node->PrevNodes()) {
-                os << std::dec << n->idx << " ";
+            for(auto n : graph.Prev(node.idx)) {
+                os << std::dec << n << " ";
             }
             os << "*/" << std::endl;
         }
 
-        if(!node->NextNodes().empty()) {
+        if(!graph.Next(node.idx).empty()) {
             os << "/* Exits to: ";
-            for (auto &n : node->NextNodes()) {
-                os << n->idx << " ";
+            for (auto n : graph.Next(node.idx)) {
+                os << n << " ";
             }
             os << "*/" << std::endl;
         }
 
-        for(size_t i = node->start;i < node->end;i++) {
-            //if(instructions[i] && !instructions[i]->opCode.isStackManipulatorOnly())
-            if(auto instr = program.GetInstructionByOffset(i))
-                if(shouldPrintStackOps || !instr->opCode.isStackManipulatorOnly()) {
-                    instr->Stream(os, shouldPrintStackOps);
-                }
-
+        for(auto instr : node.Instructions(program)) {
+            if(shouldPrintStackOps || !instr.opCode.isStackManipulatorOnly()) {
+                instr.Stream(os, shouldPrintStackOps);
+            }
         }
 
     }
@@ -505,26 +497,92 @@ std::ostream &DisassemReport::Stream(std::ostream &os) const {
 PsuedoStackReport::PsuedoStackReport(const Program &program) : ProgramReport(program) {}
 
 std::ostream &PsuedoStackReport::Stream(std::ostream &os) const {
-    for(auto& pr : program.Nodes()) {
-        auto &node = pr.second;
-        if (!node)
-            continue;
-
+    for(auto& node : program.Graph()) {
         os << "=====================================================" << std::endl;
-        os << "Node: " << node->idx << std::endl << std::endl;
+        os << "Node: " << node.idx << std::endl << std::endl;
 
-        if(node->HasPossibleEntryStackStates()) {
+        if(node.HasPossibleEntryStackStates()) {
             os << "Entry states:" << std::endl;
-            program.streamStackStates(os, node->possibleEntryStackStates);
+            program.streamStackStates(os, node.possibleEntryStackStates);
         }
 
-        if(node->HasPossibleExitStackStates()) {
+        if(node.HasPossibleExitStackStates()) {
             os << "Exit states:" << std::endl;
-            program.streamStackStates(os, node->possibleExitStackStates);
+            program.streamStackStates(os, node.possibleExitStackStates);
+        }
+
+    }
+
+    return os;
+}
+
+FunctionReport::FunctionReport(const Program &program) : ProgramReport(program) {}
+
+std::ostream &FunctionReport::Stream(std::ostream &os) const {
+    auto& graph = program.Graph();
+    for(auto& function : program.Functions().Functions()) {
+        char selector[9];
+        snprintf(selector, sizeof(selector), "%08x", function.selector);
+        os << "Function " << selector;
+        if(auto known = function.Known())
+            os << " (" << known->name << ")";
+        os << " at loc_" << std::dec << function.entry << ", dispatched at " << function.dispatchedAt << std::endl;
+
+        os << "\tBlocks: " << function.blocks.size()
+           << (function.isSolved ? " reached by its solve" : " reachable from its entry") << std::endl;
+        os << "\tAt offsets:";
+        for(auto b : function.blocks)
+            os << " " << graph[b].start;
+        os << std::endl;
+        char body[17];
+        snprintf(body, sizeof(body), "%016llx", (unsigned long long)function.bodyHash);
+        os << "\tBody: " << body << std::endl;
+        if(function.isTruncated)
+            os << "\tStopped early; results are partial" << std::endl;
+
+        for(auto& item : RunAudit(program, function).results) {
+            os << "\tAt offset " << item.Offset() << ": (" << item.Type().Severity() << ") "
+               << item.Type().Message() << std::endl;
         }
+    }
+    return os;
+}
+
+SolverReport::SolverReport(const Program &program) : ProgramReport(program) {}
 
+std::ostream &SolverReport::Stream(std::ostream &os) const {
+    auto& graph = program.Graph();
+
+    os << "Widened loop heads:" << std::endl;
+    for(auto& node : graph) {
+        if(node.isWidened)
+            os << "\tNode " << std::dec << node.idx << " at " << node.start << std::endl;
+    }
+
+    os << "Blocks with more calling contexts than kept:" << std::endl;
+    for(auto& node : graph) {
+        if(node.isStateCapped)
+            os << "\tNode " << std::dec << node.idx << " at " << node.start << std::endl;
+    }
+
+    os << "Unresolved jumps:" << std::endl;
+    for(auto offset : program.UnresolvedJumps()) {
+        os << "\tAt offset " << std::dec << offset << std::endl;
     }
 
+    auto& analysis = program.Analysis();
+    os << "Loops:" << std::endl;
+    for(auto& loop : analysis.Loops()) {
+        os << "\tHeader " << std::dec << loop.header << " at " << graph[loop.header].start
+           << ", depth " << loop.depth << ", " << loop.blocks.size() << " blocks" << std::endl;
+    }
+
+    // Only this contract's share; the contracts it creates have their own
+    os << "Budget used:" << std::endl;
+    program.Budget().Stream(os, program.BudgetSpent());
+    os << "Block evaluations: " << std::dec << program.BlockEvaluations() << std::endl;
+    if(program.IsTruncated())
+        os << "Stopped early; results are partial" << std::endl;
     return os;
 }
 
@@ -536,74 +594,83 @@ std::ostream &operator<<(std::ostream &os, const AnalysisIssue &issue) {
 }
 
 std::string CFSymbolInfo::ToString(const Program &p) const {
-    auto instr = p.GetInstructionByOffset(createdAt);
+    return std::string(p.RenderSymbol(idx));
+}
+
+void Program::renderSymbols() const {
+    renderedAt.assign(symbols.empty() ? 1 : symbols.rbegin()->first + 2, 0);
+
+    // Operands are always older symbols, so going in order renders each one
+    // once, after everything it uses
     std::stringstream ss;
-    assert(instr);
-    auto infix = instr->operands.size() <= 2 ? instr->opCode.Infix() : "";
-    if(infix.empty()) {
-        ss << instr->opCode.name;
-    }
+    size_t filled = 0;
+    for(auto& symbol : symbols) {
+        for(;filled <= symbol.first;filled++)
+            renderedAt[filled] = (uint32_t)renderedText.size();
+
+        auto instr = GetInstructionByOffset(symbol.second.createdAt);
+        assert(instr);
+        ss.str("");
+        auto infix = instr->operands.size() <= 2 ? instr->opCode.Infix() : "";
+        if(infix.empty()) {
+            ss << instr->opCode.name;
+        }
 
-    ss << "(";
-    bool isFirst = true;
+        ss << "(";
+        bool isFirst = true;
 
-    if(instr->operands.size() == 1)
-        ss << infix;
+        if(instr->operands.size() == 1)
+            ss << infix;
 
-    for (auto &op : instr->operands) {
-        if (!isFirst) {
-            if(infix.empty()) {
-                ss << ", ";
-            } else if(instr->operands.size() > 1){
-                ss << " " << infix << " ";
+        for (auto &op : instr->operands) {
+            if (!isFirst) {
+                if(infix.empty()) {
+                    ss << ", ";
+                } else if(instr->operands.size() > 1){
+                    ss << " " << infix << " ";
+                }
             }
-        }
-        isFirst = false;
+            isFirst = false;
 
-        if (op.isConstant || !op.label.empty()) {
-            ss << op;
-        } else {
-            auto sit = p.Symbols().find(op.idx);
-            assert(sit != p.Symbols().end());
-            ss << sit->second.ToString(p);
+            if (!op.isSymbolic()) {
+                expressions.Stream(ss, op);
+            } else {
+                assert(op.idx() < symbol.first && symbols.count(op.idx()));
+                auto rendered = std::string_view(renderedText).substr(renderedAt[op.idx()],
+                                                                      renderedAt[op.idx() + 1] - renderedAt[op.idx()]);
+                if(rendered.size() > MAX_INLINE_RENDER)
+                    ss << "<#" << std::dec << op.idx() << ">";
+                else
+                    ss << rendered;
+            }
         }
+        ss << ")";
+        renderedText += ss.str();
     }
-    ss << ")";
-
-    return ss.str();
+    for(;filled < renderedAt.size();filled++)
+        renderedAt[filled] = (uint32_t)renderedText.size();
 }
 
-const KnownEntryPoint *GetKnownEntryPoint(int64_t hash) {
-    static std::map<int64_t, KnownEntryPoint> knownEntryPoints;
-    static bool isInitialized = false;
-    if(!isInitialized) {
-        isInitialized = true;
-        std::ifstream fs("/keybase/team/jbchackerspace/contract-data/entryPoints.csv");
-
-        std::string line;
-        while(std::getline(fs, line)) {
-            std::stringstream ss; ss << line;
-            std::string addr;
-            int argCount;
+std::string_view Program::RenderSymbol(size_t idx) const {
+    std::call_once(renderOnce, [this] { renderSymbols(); });
+    assert(idx + 1 < renderedAt.size());
+    return std::string_view(renderedText).substr(renderedAt[idx], renderedAt[idx + 1] - renderedAt[idx]);
+}
 
-            KnownEntryPoint entryPoint;
-            ss >> addr >> entryPoint.name >> argCount;
+static std::string& selectorDatabasePath() {
+    static std::string path = "/keybase/team/jbchackerspace/contract-data/entryPoints.db";
+    return path;
+}
 
-            entryPoint.hash = strtol(addr.c_str(), 0, 16);
+void SetSelectorDatabasePath(const std::string &path) {
+    selectorDatabasePath() = path;
+}
 
-            entryPoint.arguments.resize(argCount);
-            for(int i = 0;i < argCount;i++) {
-                ss >> entryPoint.arguments[i].name;
-            }
+std::optional<KnownEntryPoint> GetKnownEntryPoint(int64_t hash) {
+    // Function local static init is thread safe; the database is read only after
+    static const SelectorDatabase database(selectorDatabasePath());
 
-            for(int i = 0;i < argCount;i++) {
-                ss >> entryPoint.arguments[i].type;
-            }
-            knownEntryPoints[entryPoint.hash] = entryPoint;
-        }
-    }
-    auto it = knownEntryPoints.find(hash);
-    if(it != knownEntryPoints.end())
-        return &it->second;
-    return nullptr;
+    if(hash < 0 || hash > UINT32_MAX)
+        return std::nullopt;
+    return database.Find((uint32_t)hash);
 }
@@ -8,28 +8,34 @@
 #include <set>
 #include <ostream>
 #include <fstream>
+#include <mutex>
+#include <string_view>
 
 #include "CFExpression.h"
 #include "CFNode.h"
+#include "CFGraph.h"
+#include "ContextGraph.h"
+#include "GraphAnalysis.h"
+#include "SSAForm.h"
+#include "TaintAnalysis.h"
+#include "FunctionTable.h"
 #include "CFInstruction.h"
+#include "InstructionStore.h"
+#include "StackSolver.h"
+#include "SelectorDatabase.h"
+#include <optional>
 
 struct Program;
 
-typedef std::vector<CFExpression> CFStack;
-typedef std::vector<size_t> executionPath;
 class CFNode;
-class CFInstruction;
+struct CFInstruction;
+class AnalysisCache;
+class ConstantMemory;
 
-struct KnownEntryPoint {
-    struct Argument {
-        std::string type, name;
-    };
-    std::vector<Argument> arguments;
-    std::string name;
-    int64_t hash;
-};
-
-const KnownEntryPoint* GetKnownEntryPoint(int64_t hash);
+// Where GetKnownEntryPoint reads selectors from; only takes effect before
+// its first lookup
+void SetSelectorDatabasePath(const std::string& path);
+std::optional<KnownEntryPoint> GetKnownEntryPoint(int64_t hash);
 
 struct AnalysisIssue {
     size_t offset;
@@ -43,64 +49,157 @@ struct AnalysisIssue {
 struct CFSymbolInfo {
     size_t idx = 0;
     size_t createdAt = 0;
-    std::set<size_t> usedAt;
 
     std::string ToString(const Program& p) const;
 };
 
 class Program {
-    std::map<size_t, std::shared_ptr<CFNode> > nodes;
+    CFGraph graph;
+    // The graph by solver state, filled in by the solve
+    ContextGraph contexts;
+    // Built once the graph is final
+    GraphAnalysis analysis;
+    SSAForm ssa;
+    TaintAnalysis taint;
+    FunctionTable functions;
     std::vector<uint8_t> byteCode;
     std::map<size_t, size_t> jumpdests;
-    std::map<size_t, std::shared_ptr<CFInstruction>> instructions;
+    InstructionStore instructions;
+    ExpressionArena expressions;
+    ExecutionPaths paths;
     std::map<size_t, CFSymbolInfo> symbols;
+    // Every symbol's rendering, back to back, built on first use: symbol i
+    // is renderedText[renderedAt[i] .. renderedAt[i+1])
+    mutable std::once_flag renderOnce;
+    mutable std::string renderedText;
+    mutable std::vector<uint32_t> renderedAt;
+    void renderSymbols() const;
     std::vector<AnalysisIssue> issues;
+    const AnalysisCache* cache = nullptr;
+    SolverOptions options;
+    // Shared with every contract this one creates
+    std::shared_ptr<AnalysisBudget> budget;
+    // What analyzing this contract took, not counting those it creates
+    AnalysisBudget::Usage budgetSpent;
+    bool isTruncated = false;
+    // How many times the solver evaluated a block; a state is evaluated once
+    // plus once per join that changed it
+    size_t blockEvaluations = 0;
+    // Offsets of jumps whose target the solver could not pin down
+    std::set<size_t> unresolvedJumps;
+    std::set<std::pair<size_t, size_t> > invalidJumps;
+    // What the solve of each dispatcher function it split off reached, by
+    // entry block
+    struct SolvedFunction {
+        // Blocks with states, sorted; empty if the budget ran out first
+        std::vector<uint32_t> blocks;
+        bool isTruncated = false;
+    };
+    std::map<size_t, SolvedFunction> solvedFunctions;
+    CFExpression newOutput(size_t& globalIdx, size_t pos, const OpCodes::OpCode& opCode);
+    // Tracks constant memory writes and folds SHA3 over them
+    void foldMemory(ConstantMemory& memory, const OpCodes::OpCode& opCode, Span<const CFExpression> operands,
+                    Span<CFExpression> outputs);
     void fillInstructions();
 
     void initGraph();
+    // Adds the edge if target is a JUMPDEST block and returns that block, or
+    // npos (flagging an issue if target is some other block)
+    size_t addJump(size_t from, size_t issueOffset, int64_t target);
+    void addInvalidJump(size_t from, size_t issueOffset, size_t to);
+    // Flags the results as partial
+    void truncate();
+
+    Program(const std::vector<uint8_t> &byteCode, const AnalysisCache* cache, const SolverOptions& options,
+            std::shared_ptr<AnalysisBudget> budget);
 public:
 
     bool IsValid() const;
     void AddIssue(size_t offset, const std::string& msg);
     const std::vector<AnalysisIssue>& Issues() const { return issues; }
-    const std::map<size_t, std::shared_ptr<CFInstruction>> &Instructions() const { return instructions; }
+    const InstructionStore& Store() const { return instructions; }
+    const ExpressionArena& Expressions() const { return expressions; }
+    const ExecutionPaths& Paths() const { return paths; }
+    InstructionRange Instructions() const { return InstructionRange(*this, 0, instructions.Size()); }
+    // Instructions starting in [startOffset, endOffset)
+    InstructionRange Instructions(size_t startOffset, size_t endOffset) const {
+        return InstructionRange(*this, instructions.LowerBound(startOffset), instructions.LowerBound(endOffset));
+    }
+    CFInstruction Instruction(size_t index) const;
     const std::vector<uint8_t>& ByteCode() const { return byteCode; }
-    const std::map<size_t, std::shared_ptr<CFNode> >& Nodes() const { return nodes; };
+    const CFGraph& Graph() const { return graph; }
+    const GraphAnalysis& Analysis() const { return analysis; }
+    const ContextGraph& Contexts() const { return contexts; }
+    // Uses of symbols are found here rather than in Symbols()
+    const SSAForm& SSA() const { return ssa; }
+    const TaintAnalysis& Taint() const { return taint; }
+    const FunctionTable& Functions() const { return functions; }
 
     const std::map<size_t, CFSymbolInfo>& Symbols() const { return symbols; };
-    std::shared_ptr<CFNode> GetNodeExactlyAt(size_t offset) const;
-    std::shared_ptr<CFNode> GetNode(size_t offset) const;
-    std::shared_ptr<CFNode> GetNode(const CFInstruction& instruction) const;
-    std::shared_ptr<CFInstruction> GetInstructionByOffset(size_t offset) const {
-        auto it = instructions.find(offset);
-        if(it != instructions.end()) {
-            return it->second;
+    // The expression symbol idx stands for, with its operands' expressions
+    // inlined in turn, except that any longer than MAX_INLINE_RENDER is left
+    // as a <#N> reference
+    std::string_view RenderSymbol(size_t idx) const;
+    static const size_t MAX_INLINE_RENDER = 256;
+    const std::set<size_t>& UnresolvedJumps() const { return unresolvedJumps; }
+    const AnalysisBudget& Budget() const { return *budget; }
+    const AnalysisBudget::Usage& BudgetSpent() const { return budgetSpent; }
+    size_t BlockEvaluations() const { return blockEvaluations; }
+    // True if the budget ran out before this contract, or one it creates,
+    // was fully analyzed. What was found is still there to audit.
+    bool IsTruncated() const;
+    const CFNode* GetNodeExactlyAt(size_t offset) const;
+    const CFNode* GetNode(size_t offset) const;
+    const CFNode* GetNode(const CFInstruction& instruction) const;
+    std::optional<CFInstruction> GetInstructionByOffset(size_t offset) const {
+        auto i = instructions.IndexAt(offset);
+        if(i != InstructionStore::npos) {
+            return Instruction(i);
         }
-        return nullptr;
+        return std::nullopt;
     }
 
-    Program(const std::vector<uint8_t> &byteCode);
-    ~Program();
+    Program(const std::vector<uint8_t> &byteCode, const AnalysisCache* cache = nullptr,
+            const SolverOptions& options = SolverOptions());
 
-    void print(bool showStackOps, bool showUnreachable);
+    void print(std::ostream& os, bool showStackOps, bool showUnreachable) const;
 
     void startGraph();
 
     bool solveStack();
 
-    void solveStack(size_t& globalIdx,
-                    std::shared_ptr<CFNode> node,
-                    std::shared_ptr<CFNode> pnode);
 
-    std::ostream& streamStackStates(std::ostream& os, const std::map<CFStack, std::vector<executionPath> > &stackStates) const;
+    std::ostream& streamStackStates(std::ostream& os, const CFStackStates &stackStates) const;
 
+    // Parallel vectors; a contract already in the cache is never built, so
+    // its createdContracts entry is null.
     std::vector<std::shared_ptr<Program>> createdContracts;
+    std::vector<std::vector<uint8_t>> createdByteCodes;
 
     void findCreatedContracts();
 
     friend class ProgramReport;
+    friend class StackSolver;
+    friend class FunctionTable;
 };
 
+inline CFInstruction Program::Instruction(size_t index) const {
+    auto offset = instructions.Offset(index);
+    auto& opCode = instructions.OpCodeAt(index);
+    return CFInstruction(*this, index, offset, opCode,
+                         Span<const uint8_t>(byteCode.data() + offset + 1, opCode.length),
+                         instructions.Operands(index), instructions.Outputs(index));
+}
+
+inline CFInstruction InstructionRange::iterator::operator*() const {
+    return program->Instruction(index);
+}
+
+inline CFInstruction InstructionRange::back() const {
+    assert(!empty());
+    return program->Instruction(last - 1);
+}
+
 class ProgramReport {
 protected:
     const Program& program;
@@ -123,5 +222,21 @@ class PsuedoStackReport : public ProgramReport {
 public:
     PsuedoStackReport(const Program &program);
 
+    std::ostream &Stream(std::ostream &os) const override;
+};
+
+// The dispatcher's functions, their slices and what auditing each finds
+class FunctionReport : public ProgramReport {
+public:
+    FunctionReport(const Program &program);
+
+    std::ostream &Stream(std::ostream &os) const override;
+};
+
+// Where the stack solver had to give up precision
+class SolverReport : public ProgramReport {
+public:
+    SolverReport(const Program &program);
+
     std::ostream &Stream(std::ostream &os) const override;
 };
\ No newline at end of file
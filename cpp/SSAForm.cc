@@ -0,0 +1,392 @@
+#include <assert.h>
+#include <algorithm>
+#include <unordered_map>
+#include "SSAForm.h"
+#include "Program.h"
+
+// Deeper than this the EVM has already failed, so nothing below is read
+static const size_t MAX_STACK = 1024;
+
+struct SSAForm::Builder {
+    const Program& program;
+    const CFGraph& graph;
+    const InstructionStore& store;
+    SSAForm& ssa;
+
+    // Each block's stack at its end, top first, how many arguments of its
+    // head had been read by then, and the JUMPDEST block the stack started
+    // at (NONE before the first one)
+    std::vector<uint32_t> exitAt = { 0 };
+    CFStack exitSlots;
+    std::vector<uint32_t> exitArguments, headOf;
+
+    std::unordered_map<uint32_t, Value> constants;
+    // (block << 32 | slot) to its phi
+    std::unordered_map<uint64_t, Value> phiAt;
+    // Phis in the order they were made; their incoming values are filled in
+    // that same order
+    std::vector<Value> phis;
+    std::vector<uint32_t> phiSlot, phiOf;
+    std::vector<uint32_t> incomingAt = { 0 };
+    std::vector<Value> incoming;
+    std::vector<uint32_t> incomingFrom;
+    // Where each value ends up once trivial phis are gone
+    std::vector<Value> forward;
+
+    Builder(const Program& program, SSAForm& ssa)
+            : program(program), graph(program.Graph()), store(program.Store()), ssa(ssa) {}
+
+    Value newValue(Kind kind, CFExpression e, uint32_t definedAt) {
+        auto v = (Value)ssa.kinds.size();
+        ssa.kinds.push_back(kind);
+        ssa.expressions.push_back(e);
+        ssa.definedAt.push_back(definedAt);
+        phiOf.push_back(NONE);
+        return v;
+    }
+
+    Value constant(CFExpression e) {
+        auto it = constants.find(e.handle);
+        if(it != constants.end())
+            return it->second;
+        auto v = newValue(CONSTANT, e, NONE);
+        constants.emplace(e.handle, v);
+        return v;
+    }
+
+    // Slot of head's entry stack. Its incoming values are filled in later,
+    // so this never recurses.
+    Value entry(uint32_t head, size_t slot) {
+        if(head == NONE || slot >= MAX_STACK || (head != 0 && graph.Prev(head).empty()))
+            return UNDEFINED;
+
+        auto key = ((uint64_t)head << 32) | (uint32_t)slot;
+        auto it = phiAt.find(key);
+        if(it != phiAt.end())
+            return it->second;
+
+        auto v = newValue(PHI, CFExpression(), head);
+        phiOf[v] = (uint32_t)phis.size();
+        phis.push_back(v);
+        phiSlot.push_back((uint32_t)slot);
+        phiAt.emplace(key, v);
+        return v;
+    }
+
+    Value valueOf(CFExpression e, uint32_t head) {
+        switch(e.kind()) {
+            case CFExpression::SYMBOL:
+                assert(ssa.OfSymbol(e.idx()) != NONE);
+                return ssa.OfSymbol(e.idx()) == NONE ? UNDEFINED : ssa.OfSymbol(e.idx());
+            case CFExpression::CONSTANT:
+                return constant(e);
+            case CFExpression::ARGUMENT:
+                return entry(head, e.idx());
+            default:
+                // The store only holds what fillInstructions made
+                return UNDEFINED;
+        }
+    }
+
+    Value exitValue(size_t block, size_t slot) {
+        auto depth = exitAt[block + 1] - exitAt[block];
+        if(slot < depth)
+            return valueOf(exitSlots[exitAt[block] + slot], headOf[block]);
+        return entry(headOf[block], exitArguments[block] + slot - depth);
+    }
+
+    // Replays fillInstructions' stack to get each block's exit stack, and
+    // makes a value for every symbol an instruction outputs
+    void scanBlocks() {
+        newValue(UNDEFINED_VALUE, CFExpression::Unknown(), NONE);
+
+        CFStack stack;
+        uint32_t arguments = 0, head = NONE;
+        for(size_t b = 0;b < graph.Size();b++) {
+            auto& node = graph[b];
+            if(node.isJumpDest) {
+                stack.clear();
+                arguments = 0;
+                head = (uint32_t)b;
+            }
+
+            for(size_t i = node.first;i < node.last;i++) {
+                auto& opCode = store.OpCodeAt(i);
+                for(size_t k = 0;k < opCode.stackRemoved;k++) {
+                    if(stack.empty())
+                        arguments++;
+                    else
+                        stack.pop_back();
+                }
+
+                auto outputs = store.Outputs(i);
+                for(size_t k = outputs.size();k-- > 0;)
+                    stack.push_back(outputs[k]);
+
+                if(opCode.isStackManipulatorOnly())
+                    continue;
+                for(auto& output : outputs) {
+                    if(!output.isSymbolic())
+                        continue;
+                    if(output.idx() >= ssa.symbolValues.size())
+                        ssa.symbolValues.resize(output.idx() + 1, NONE);
+                    ssa.symbolValues[output.idx()] = newValue(OUTPUT, output, (uint32_t)i);
+                }
+            }
+
+            headOf.push_back(head);
+            exitArguments.push_back(arguments);
+            auto depth = std::min(stack.size(), MAX_STACK);
+            exitSlots.insert(exitSlots.end(), stack.rbegin(), stack.rbegin() + depth);
+            exitAt.push_back((uint32_t)exitSlots.size());
+        }
+    }
+
+    void readOperands() {
+        ssa.operandsAt.assign(store.Size() + 1, 0);
+        for(size_t i = 0;i < store.Size();i++)
+            ssa.operandsAt[i + 1] = ssa.operandsAt[i] + store.OpCodeAt(i).stackRemoved;
+        ssa.operandValues.assign(ssa.operandsAt.back(), NONE);
+
+        for(size_t b = 0;b < graph.Size();b++) {
+            auto& node = graph[b];
+            for(size_t i = node.first;i < node.last;i++) {
+                if(store.OpCodeAt(i).isStackManipulatorOnly())
+                    continue;
+                auto operands = store.Operands(i);
+                for(size_t k = 0;k < operands.size();k++)
+                    ssa.operandValues[ssa.operandsAt[i] + k] = valueOf(operands[k], headOf[b]);
+            }
+        }
+    }
+
+    // Reading a predecessor's exit can make new phis; they are appended and
+    // filled in by the same loop
+    void fillPhis() {
+        for(size_t p = 0;p < phis.size();p++) {
+            auto block = ssa.definedAt[phis[p]];
+            auto slot = phiSlot[p];
+            if(block == 0) {
+                incoming.push_back(UNDEFINED);
+                incomingFrom.push_back(NONE);
+            }
+            for(auto pred : graph.Prev(block)) {
+                auto v = exitValue(pred, slot);
+                incoming.push_back(v);
+                incomingFrom.push_back(pred);
+            }
+            incomingAt.push_back((uint32_t)incoming.size());
+        }
+    }
+
+    Value find(Value v) {
+        auto root = v;
+        while(forward[root] != root)
+            root = forward[root];
+        while(forward[v] != root) {
+            auto next = forward[v];
+            forward[v] = root;
+            v = next;
+        }
+        return root;
+    }
+
+    void removeTrivialPhis() {
+        forward.resize(ssa.kinds.size());
+        for(size_t v = 0;v < forward.size();v++)
+            forward[v] = (Value)v;
+
+        // Phis reading each phi, to look at again once it is gone
+        std::vector<uint32_t> usersAt(phis.size() + 1, 0), users;
+        for(auto v : incoming) {
+            if(phiOf[v] != NONE)
+                usersAt[phiOf[v] + 1]++;
+        }
+        for(size_t p = 0;p < phis.size();p++)
+            usersAt[p + 1] += usersAt[p];
+        users.resize(usersAt.back());
+        std::vector<uint32_t> fill(usersAt.begin(), usersAt.end() - 1);
+        for(size_t p = 0;p < phis.size();p++) {
+            for(auto i = incomingAt[p];i < incomingAt[p + 1];i++) {
+                if(phiOf[incoming[i]] != NONE)
+                    users[fill[phiOf[incoming[i]]]++] = (uint32_t)p;
+            }
+        }
+
+        // Users are those of the phi as made, not of whatever replaced it,
+        // so go round again until a round removes nothing
+        std::vector<uint32_t> work;
+        std::vector<bool> isQueued(phis.size());
+        for(bool isChanged = true;isChanged;) {
+            isChanged = false;
+            for(size_t p = phis.size();p-- > 0;) {
+                if(find(phis[p]) == phis[p]) {
+                    isQueued[p] = true;
+                    work.push_back((uint32_t)p);
+                }
+            }
+
+            while(!work.empty()) {
+                auto p = work.back();
+                work.pop_back();
+                isQueued[p] = false;
+                auto v = phis[p];
+                if(find(v) != v)
+                    continue;
+
+                Value same = NONE;
+                bool isTrivial = true;
+                for(auto i = incomingAt[p];i < incomingAt[p + 1];i++) {
+                    auto in = find(incoming[i]);
+                    if(in == v || in == same)
+                        continue;
+                    if(same != NONE) {
+                        isTrivial = false;
+                        break;
+                    }
+                    same = in;
+                }
+                if(!isTrivial)
+                    continue;
+
+                // Only ever reads itself: a cycle nothing enters
+                forward[v] = same == NONE ? UNDEFINED : same;
+                isChanged = true;
+                for(auto i = usersAt[p];i < usersAt[p + 1];i++) {
+                    if(!isQueued[users[i]]) {
+                        isQueued[users[i]] = true;
+                        work.push_back(users[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Renumbers so the phis left come last, by block and slot, and drops
+    // the rest
+    void compact() {
+        auto count = ssa.kinds.size();
+        std::vector<Value> remap(count, NONE);
+        std::vector<Kind> kinds;
+        std::vector<CFExpression> expressions;
+        std::vector<uint32_t> definedAt;
+
+        auto keep = [&](Value v) {
+            remap[v] = (Value)kinds.size();
+            kinds.push_back(ssa.kinds[v]);
+            expressions.push_back(ssa.expressions[v]);
+            definedAt.push_back(ssa.definedAt[v]);
+        };
+        for(size_t v = 0;v < count;v++) {
+            if(ssa.kinds[v] != PHI)
+                keep((Value)v);
+        }
+
+        std::vector<uint32_t> live;
+        for(size_t p = 0;p < phis.size();p++) {
+            if(find(phis[p]) == phis[p])
+                live.push_back((uint32_t)p);
+        }
+        std::sort(live.begin(), live.end(), [&](uint32_t a, uint32_t b) {
+            return std::make_pair(ssa.definedAt[phis[a]], phiSlot[a]) <
+                   std::make_pair(ssa.definedAt[phis[b]], phiSlot[b]);
+        });
+
+        ssa.firstPhi = (Value)kinds.size();
+        for(auto p : live)
+            keep(phis[p]);
+        for(size_t v = 0;v < count;v++) {
+            if(remap[v] == NONE)
+                remap[v] = remap[find((Value)v)];
+        }
+
+        ssa.phisAt.assign(graph.Size() + 1, 0);
+        ssa.incomingAt.assign(1, 0);
+        for(auto p : live) {
+            ssa.phiValues.push_back(remap[phis[p]]);
+            ssa.phiSlots.push_back(phiSlot[p]);
+            ssa.phisAt[ssa.definedAt[phis[p]] + 1]++;
+            for(auto i = incomingAt[p];i < incomingAt[p + 1];i++) {
+                ssa.incomingValues.push_back(remap[incoming[i]]);
+                ssa.incomingBlocks.push_back(incomingFrom[i]);
+            }
+            ssa.incomingAt.push_back((uint32_t)ssa.incomingValues.size());
+        }
+        for(size_t b = 0;b < graph.Size();b++)
+            ssa.phisAt[b + 1] += ssa.phisAt[b];
+
+        for(auto& v : ssa.operandValues) {
+            if(v != NONE)
+                v = remap[v];
+        }
+        for(auto& v : ssa.symbolValues) {
+            if(v != NONE)
+                v = remap[v];
+        }
+
+        ssa.kinds = std::move(kinds);
+        ssa.expressions = std::move(expressions);
+        ssa.definedAt = std::move(definedAt);
+    }
+
+    void findUses() {
+        auto& usesAt = ssa.usesAt;
+        usesAt.assign(ssa.Size() + 1, 0);
+        for(auto v : ssa.operandValues) {
+            if(v != NONE)
+                usesAt[v + 1]++;
+        }
+        for(auto v : ssa.incomingValues)
+            usesAt[v + 1]++;
+        for(size_t v = 0;v < ssa.Size();v++)
+            usesAt[v + 1] += usesAt[v];
+
+        ssa.uses.resize(usesAt.back());
+        std::vector<uint32_t> fill(usesAt.begin(), usesAt.end() - 1);
+        for(size_t i = 0;i < store.Size();i++) {
+            for(auto k = ssa.operandsAt[i];k < ssa.operandsAt[i + 1];k++) {
+                auto v = ssa.operandValues[k];
+                if(v != NONE)
+                    ssa.uses[fill[v]++] = { (uint32_t)i, k - ssa.operandsAt[i], false };
+            }
+        }
+        for(size_t p = 0;p < ssa.phiValues.size();p++) {
+            for(auto k = ssa.incomingAt[p];k < ssa.incomingAt[p + 1];k++) {
+                auto v = ssa.incomingValues[k];
+                ssa.uses[fill[v]++] = { ssa.phiValues[p], k - ssa.incomingAt[p], true };
+            }
+        }
+    }
+};
+
+SSAForm::SSAForm(const Program &program) {
+    Builder builder(program, *this);
+    builder.scanBlocks();
+    builder.readOperands();
+    builder.fillPhis();
+    builder.removeTrivialPhis();
+    builder.compact();
+    builder.findUses();
+}
+
+size_t SSAForm::Slot(Value phi) const {
+    assert(kinds[phi] == PHI);
+    return phiSlots[phi - firstPhi];
+}
+
+Span<const SSAForm::Value> SSAForm::Incoming(Value phi) const {
+    assert(kinds[phi] == PHI);
+    auto p = phi - firstPhi;
+    return Span<const Value>(incomingValues.data() + incomingAt[p], incomingAt[p + 1] - incomingAt[p]);
+}
+
+Span<const uint32_t> SSAForm::IncomingBlocks(Value phi) const {
+    assert(kinds[phi] == PHI);
+    auto p = phi - firstPhi;
+    return Span<const uint32_t>(incomingBlocks.data() + incomingAt[p], incomingAt[p + 1] - incomingAt[p]);
+}
+
+bool SSAForm::IsSingleUse(Value v) const {
+    auto u = Uses(v);
+    return u.size() == 1 && !u[0].isPhi;
+}
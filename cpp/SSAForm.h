@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "CFExpression.h"
+#include "Span.h"
+
+class Program;
+
+/***
+ * SSA form of a program's stack values, built once the graph is final.
+ *
+ * Inside a block every stack value already has a name: instruction outputs
+ * are symbols, and a slot read from below the stack is an argument of the
+ * JUMPDEST block the stack was started at. Across blocks, an argument that
+ * is read becomes a phi of that slot at the end of each predecessor. Phis
+ * are only placed for arguments something reads, and one whose incoming
+ * values are all the same value (or itself) is replaced by that value, as
+ * in Braun et al., "Simple and Efficient Construction of SSA Form". The
+ * phis left are real joins.
+ *
+ * Values are dense ids. Use-def (what each instruction reads, what flows
+ * into each phi) and def-use (every read of a value) are flat rows indexed
+ * by instruction or value, so following data flow is a walk over arrays.
+ */
+class SSAForm {
+public:
+    typedef uint32_t Value;
+    static constexpr Value NONE = UINT32_MAX;
+    // Anything read below the empty stack the program starts with
+    static constexpr Value UNDEFINED = 0;
+    static constexpr size_t npos = (size_t)-1;
+
+    enum Kind : uint8_t {
+        UNDEFINED_VALUE,
+        CONSTANT,
+        // Output of an instruction
+        OUTPUT,
+        PHI
+    };
+
+    struct Use {
+        // Instruction index, or the phi's value for phi uses
+        uint32_t user;
+        // Operand of the instruction, or incoming edge of the phi
+        uint32_t operand;
+        bool isPhi;
+    };
+
+    SSAForm() = default;
+    explicit SSAForm(const Program& program);
+
+    size_t Size() const { return kinds.size(); }
+    Kind KindOf(Value v) const { return kinds[v]; }
+    // The constant, or the output's symbol
+    CFExpression Expression(Value v) const { return expressions[v]; }
+    // Instruction index of an output, block of a phi, npos otherwise
+    size_t DefinedAt(Value v) const { return definedAt[v] == NONE ? npos : definedAt[v]; }
+
+    // One value per operand of the instruction. Stack only instructions
+    // just move values around, so theirs are NONE.
+    Span<const Value> Operands(size_t instruction) const {
+        return Span<const Value>(operandValues.data() + operandsAt[instruction],
+                                 operandsAt[instruction + 1] - operandsAt[instruction]);
+    }
+
+    // Phis at the start of block, in slot order
+    Span<const Value> Phis(size_t block) const {
+        return Span<const Value>(phiValues.data() + phisAt[block], phisAt[block + 1] - phisAt[block]);
+    }
+    size_t PhiCount() const { return phiValues.size(); }
+    // Stack slot a phi merges, 0 being the top on entry
+    size_t Slot(Value phi) const;
+    // What flows into a phi, one per predecessor, from the blocks in
+    // IncomingBlocks (NONE for the program's entry)
+    Span<const Value> Incoming(Value phi) const;
+    Span<const uint32_t> IncomingBlocks(Value phi) const;
+
+    Span<const Use> Uses(Value v) const {
+        return Span<const Use>(uses.data() + usesAt[v], usesAt[v + 1] - usesAt[v]);
+    }
+    // True if one instruction, and nothing else, reads v once
+    bool IsSingleUse(Value v) const;
+
+    // The value a symbol of the instruction store names, NONE if none does
+    Value OfSymbol(size_t idx) const { return idx < symbolValues.size() ? symbolValues[idx] : NONE; }
+
+private:
+    struct Builder;
+
+    std::vector<Kind> kinds;
+    std::vector<CFExpression> expressions;
+    std::vector<uint32_t> definedAt;
+    std::vector<uint32_t> symbolValues;
+
+    // Instruction i reads operandValues[operandsAt[i] .. operandsAt[i+1])
+    std::vector<uint32_t> operandsAt;
+    std::vector<Value> operandValues;
+
+    // Phis are the last values, ordered by block then slot
+    Value firstPhi = 0;
+    std::vector<uint32_t> phisAt;
+    std::vector<Value> phiValues;
+    std::vector<uint32_t> phiSlots;
+    // Phi p's incoming values are at [incomingAt[p - firstPhi], incomingAt[p - firstPhi + 1])
+    std::vector<uint32_t> incomingAt;
+    std::vector<Value> incomingValues;
+    std::vector<uint32_t> incomingBlocks;
+
+    std::vector<uint32_t> usesAt;
+    std::vector<Use> uses;
+};
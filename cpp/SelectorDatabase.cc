@@ -0,0 +1,261 @@
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include "SelectorDatabase.h"
+
+static const char MAGIC[8] = { 'E', 'A', 'S', 'E', 'L', 'D', 'B', '1' };
+// Seeds with this bit set are the slot of a bucket's only selector
+static const uint32_t DIRECT_SLOT = 0x80000000u;
+// Selectors per bucket, on average
+static const uint32_t BUCKET_LOAD = 4;
+static const uint32_t MAX_SEED = 1u << 24;
+
+static uint32_t mix(uint32_t selector, uint32_t seed) {
+    // Murmur3's 64 bit finalizer
+    uint64_t h = (uint64_t)selector | (uint64_t)seed << 32;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+SelectorDatabase::SelectorDatabase(const std::string &fileName) : file(fileName) {
+    if(!file.IsOpen() || file.Size() < sizeof(Header))
+        return;
+    auto data = file.Data();
+    header = reinterpret_cast<const Header*>(data);
+    if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || (header->count && !header->buckets) ||
+       header->count >= DIRECT_SLOT) {
+        header = nullptr;
+        return;
+    }
+
+    uint64_t size = sizeof(Header) + (uint64_t)header->buckets * sizeof(uint32_t) +
+            (uint64_t)header->count * sizeof(Entry) +
+            (uint64_t)header->argumentCount * sizeof(KnownEntryPoint::ArgumentRecord) + header->poolSize;
+    // Strings are read up to their NUL, so the pool has to end in one
+    if(size != file.Size() || !header->poolSize || data[size - 1] != 0) {
+        header = nullptr;
+        return;
+    }
+
+    data += sizeof(Header);
+    seeds = reinterpret_cast<const uint32_t*>(data);
+    data += header->buckets * sizeof(uint32_t);
+    entries = reinterpret_cast<const Entry*>(data);
+    data += header->count * sizeof(Entry);
+    arguments = reinterpret_cast<const KnownEntryPoint::ArgumentRecord*>(data);
+    data += header->argumentCount * sizeof(KnownEntryPoint::ArgumentRecord);
+    pool = data;
+    isValid = true;
+}
+
+std::optional<KnownEntryPoint> SelectorDatabase::Find(uint32_t selector) const {
+    if(!isValid || !header->count)
+        return std::nullopt;
+
+    auto seed = seeds[mix(selector, 0) % header->buckets];
+    auto slot = (seed & DIRECT_SLOT) ? seed & ~DIRECT_SLOT : mix(selector, seed) % header->count;
+    if(slot >= header->count)
+        return std::nullopt;
+    auto& entry = entries[slot];
+    if(entry.selector != selector || entry.name >= header->poolSize ||
+       entry.firstArgument > header->argumentCount ||
+       entry.argumentCount > header->argumentCount - entry.firstArgument)
+        return std::nullopt;
+
+    auto entryArguments = Span<const KnownEntryPoint::ArgumentRecord>(arguments + entry.firstArgument,
+                                                                     entry.argumentCount);
+    for(auto& argument : entryArguments) {
+        if(argument.name >= header->poolSize || argument.type >= header->poolSize)
+            return std::nullopt;
+    }
+    return KnownEntryPoint(pool + entry.name, selector, pool, entryArguments);
+}
+
+namespace {
+    struct CompiledEntryPoint {
+        uint32_t selector;
+        std::string name;
+        std::vector<std::string> names, types;
+    };
+
+    class StringPool {
+        std::unordered_map<std::string, uint32_t> offsets;
+    public:
+        std::string text;
+
+        uint32_t Add(const std::string& s) {
+            auto it = offsets.find(s);
+            if(it != offsets.end())
+                return it->second;
+            auto offset = (uint32_t)text.size();
+            text += s;
+            text += '\0';
+            offsets.emplace(s, offset);
+            return offset;
+        }
+    };
+
+    void readEntryPoints(std::istream& is, std::vector<CompiledEntryPoint>& entryPoints,
+                         std::unordered_map<uint32_t, size_t>& indexOf) {
+        std::string line;
+        while(std::getline(is, line)) {
+            std::stringstream ss(line);
+            std::string addr;
+            int argCount = 0;
+            CompiledEntryPoint entryPoint;
+            if(!(ss >> addr >> entryPoint.name >> argCount) || argCount < 0)
+                continue;
+
+            char* end = nullptr;
+            auto hash = strtoll(addr.c_str(), &end, 16);
+            if(*end || hash < 0 || hash > UINT32_MAX)
+                continue;
+            entryPoint.selector = (uint32_t)hash;
+
+            entryPoint.names.resize(argCount);
+            entryPoint.types.resize(argCount);
+            for(auto& name : entryPoint.names)
+                ss >> name;
+            for(auto& type : entryPoint.types)
+                ss >> type;
+            if(!ss)
+                continue;
+
+            auto it = indexOf.find(entryPoint.selector);
+            if(it != indexOf.end()) {
+                entryPoints[it->second] = std::move(entryPoint);
+            } else {
+                indexOf.emplace(entryPoint.selector, entryPoints.size());
+                entryPoints.push_back(std::move(entryPoint));
+            }
+        }
+    }
+
+    // Seeds for each bucket so that every selector gets its own slot in
+    // [0, selectors.size()); false if some bucket has no such seed
+    bool placeSelectors(const std::vector<uint32_t>& selectors, std::vector<uint32_t>& seeds,
+                        std::vector<uint32_t>& slotOf) {
+        auto count = (uint32_t)selectors.size();
+        std::vector<std::vector<uint32_t>> buckets(seeds.size());
+        for(uint32_t i = 0;i < count;i++)
+            buckets[mix(selectors[i], 0) % seeds.size()].push_back(i);
+
+        // Largest first, while there are still plenty of free slots
+        std::vector<uint32_t> order(buckets.size());
+        for(uint32_t b = 0;b < buckets.size();b++)
+            order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        std::vector<bool> isTaken(count);
+        std::vector<uint32_t> slots;
+        uint32_t nextFree = 0;
+        for(auto b : order) {
+            auto& bucket = buckets[b];
+            if(bucket.empty())
+                break;
+            if(bucket.size() == 1) {
+                while(isTaken[nextFree])
+                    nextFree++;
+                isTaken[nextFree] = true;
+                slotOf[bucket[0]] = nextFree;
+                seeds[b] = DIRECT_SLOT | nextFree;
+                continue;
+            }
+
+            uint32_t seed = 1;
+            for(;seed < MAX_SEED;seed++) {
+                slots.clear();
+                for(auto i : bucket) {
+                    auto slot = mix(selectors[i], seed) % count;
+                    if(isTaken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                        break;
+                    slots.push_back(slot);
+                }
+                if(slots.size() == bucket.size())
+                    break;
+            }
+            if(seed == MAX_SEED)
+                return false;
+            for(size_t k = 0;k < bucket.size();k++) {
+                isTaken[slots[k]] = true;
+                slotOf[bucket[k]] = slots[k];
+            }
+            seeds[b] = seed;
+        }
+        return true;
+    }
+}
+
+bool SelectorDatabase::Compile(const std::vector<std::string> &csvFiles, const std::string &fileName,
+                               std::string *error) {
+    std::vector<CompiledEntryPoint> entryPoints;
+    std::unordered_map<uint32_t, size_t> indexOf;
+    for(auto& csvFile : csvFiles) {
+        std::ifstream fs(csvFile);
+        if(!fs) {
+            if(error) *error = "Could not open " + csvFile;
+            return false;
+        }
+        readEntryPoints(fs, entryPoints, indexOf);
+    }
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.count = (uint32_t)entryPoints.size();
+    header.buckets = (header.count + BUCKET_LOAD - 1) / BUCKET_LOAD;
+
+    std::vector<uint32_t> selectors;
+    selectors.reserve(entryPoints.size());
+    for(auto& entryPoint : entryPoints)
+        selectors.push_back(entryPoint.selector);
+    std::vector<uint32_t> seeds(header.buckets), slotOf(header.count);
+    if(!placeSelectors(selectors, seeds, slotOf)) {
+        if(error) *error = "Could not find a perfect hash for the selectors";
+        return false;
+    }
+
+    StringPool pool;
+    std::vector<Entry> entries(header.count);
+    std::vector<KnownEntryPoint::ArgumentRecord> arguments;
+    // Arguments are laid out in slot order, so lookups near each other in
+    // the table read near each other in the file
+    std::vector<uint32_t> atSlot(header.count);
+    for(uint32_t i = 0;i < header.count;i++)
+        atSlot[slotOf[i]] = i;
+    for(uint32_t slot = 0;slot < header.count;slot++) {
+        auto& entryPoint = entryPoints[atSlot[slot]];
+        auto& entry = entries[slot];
+        entry.selector = entryPoint.selector;
+        entry.name = pool.Add(entryPoint.name);
+        entry.firstArgument = (uint32_t)arguments.size();
+        entry.argumentCount = (uint32_t)entryPoint.names.size();
+        for(size_t k = 0;k < entryPoint.names.size();k++)
+            arguments.push_back({ pool.Add(entryPoint.names[k]), pool.Add(entryPoint.types[k]) });
+    }
+    // Never empty, so a valid file always ends in a NUL
+    if(pool.text.empty())
+        pool.text += '\0';
+    header.argumentCount = (uint32_t)arguments.size();
+    header.poolSize = (uint32_t)pool.text.size();
+
+    std::ofstream fs(fileName, std::ios::binary | std::ios::trunc);
+    fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fs.write(reinterpret_cast<const char*>(seeds.data()), seeds.size() * sizeof(uint32_t));
+    fs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    fs.write(reinterpret_cast<const char*>(arguments.data()),
+             arguments.size() * sizeof(KnownEntryPoint::ArgumentRecord));
+    fs.write(pool.text.data(), pool.text.size());
+    if(!fs) {
+        if(error) *error = "Could not write " + fileName;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ByteCodeFile.h"
+#include "Span.h"
+
+/***
+ * A known function, as a view into the SelectorDatabase it came from;
+ * valid as long as that is.
+ */
+struct KnownEntryPoint {
+    struct Argument {
+        std::string_view type, name;
+    };
+    struct ArgumentRecord {
+        uint32_t name, type;
+    };
+
+    std::string_view name;
+    int64_t hash = 0;
+
+    size_t ArgumentCount() const { return arguments.size(); }
+    Argument ArgumentAt(size_t i) const { return { pool + arguments[i].type, pool + arguments[i].name }; }
+
+    KnownEntryPoint(std::string_view name, int64_t hash, const char* pool, Span<const ArgumentRecord> arguments)
+            : name(name), hash(hash), pool(pool), arguments(arguments) {}
+private:
+    const char* pool;
+    Span<const ArgumentRecord> arguments;
+};
+
+/***
+ * Function selectors with their names and argument names and types, read
+ * in place from a file mapped into memory. Lookups allocate nothing and,
+ * since nothing changes once the file is open, are safe from any thread.
+ *
+ * The file is compiled from entryPoints.csv lines. Selectors are placed
+ * by a minimal perfect hash in the style of CHD (hash, displace and
+ * compress): each selector's bucket holds either the seed that sends every
+ * selector in it to a distinct slot, or for a bucket of one the slot
+ * itself. A lookup is two hashes and a compare against the stored
+ * selector, which also turns away selectors that are not there. Names
+ * and types are pooled, each distinct string stored once.
+ *
+ * The file is in the byte order of the machine that compiled it.
+ */
+class SelectorDatabase {
+public:
+    struct Header {
+        char magic[8];
+        uint32_t count, buckets, argumentCount, poolSize;
+    };
+    struct Entry {
+        uint32_t selector, name, firstArgument, argumentCount;
+    };
+
+    explicit SelectorDatabase(const std::string& fileName);
+
+    // False if the file is missing or not a database
+    bool IsValid() const { return isValid; }
+    size_t Size() const { return header ? header->count : 0; }
+
+    std::optional<KnownEntryPoint> Find(uint32_t selector) const;
+
+    // Compiles entryPoints.csv files into fileName. Lines are 'selector
+    // name count names... types...'; for a selector given twice the last
+    // line wins.
+    static bool Compile(const std::vector<std::string>& csvFiles, const std::string& fileName, std::string* error);
+private:
+    MappedFile file;
+    bool isValid = false;
+    const Header* header = nullptr;
+    const uint32_t* seeds = nullptr;
+    const Entry* entries = nullptr;
+    const KnownEntryPoint::ArgumentRecord* arguments = nullptr;
+    const char* pool = nullptr;
+};
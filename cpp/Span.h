@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdlib.h>
+#include <assert.h>
+#include <type_traits>
+#include <vector>
+
+/***
+ * Non-owning view of a contiguous run of T's.
+ */
+template <typename T>
+class Span {
+    T* first = nullptr;
+    size_t count = 0;
+public:
+    Span() = default;
+    Span(T* first, size_t count) : first(first), count(count) {}
+
+    template <typename U, typename = typename std::enable_if<
+            std::is_convertible<U(*)[], T(*)[]>::value>::type>
+    Span(const Span<U>& other) : first(other.data()), count(other.size()) {}
+
+    template <typename A>
+    Span(std::vector<typename std::remove_const<T>::type, A>& v) : first(v.data()), count(v.size()) {}
+
+    template <typename A>
+    Span(const std::vector<typename std::remove_const<T>::type, A>& v) : first(v.data()), count(v.size()) {}
+
+    T* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T* begin() const { return first; }
+    T* end() const { return first + count; }
+
+    T& operator[](size_t i) const { assert(i < count); return first[i]; }
+    T& front() const { assert(count); return first[0]; }
+    T& back() const { assert(count); return first[count - 1]; }
+};
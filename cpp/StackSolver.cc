@@ -0,0 +1,669 @@
+#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include "StackSolver.h"
+#include "Program.h"
+#include "ThreadPool.h"
+
+std::string SolverOptions::Fingerprint() const {
+    std::stringstream ss;
+    ss << "states=" << maxStatesPerNode << ",set=" << maxConstantSet << ",paths=" << maxPathsPerState;
+    // Results cut short are never cached, so the time limit can't change
+    // what is; the counts still show in the solver report
+    ss << ",budget=" << budget.states << "/" << budget.paths << "/" << budget.bytes;
+    ss << ",function=" << functionBudget.states << "/" << functionBudget.paths << "/" << functionBudget.bytes;
+    return ss.str();
+}
+
+// One dispatcher function, solved on its own from the states that reached
+// its entry
+struct StackSolver::Function {
+    size_t entry;
+    std::vector<State> seeds;
+    // Layered over the program's, so they only hold what this function adds
+    ExpressionArena arena;
+    ExecutionPaths paths;
+    AnalysisBudget budget;
+    std::unique_ptr<StackSolver> solver;
+    // The solver's nodes that ended up with anything in them
+    std::vector<std::pair<size_t, NodeStates>> results;
+    // Those with states, sorted
+    std::vector<uint32_t> blocks;
+
+    Function(const ExpressionArena& arena, const ExecutionPaths& paths, const AnalysisBudget& budget,
+             const AnalysisBudget::Limits& cap)
+            : arena(&arena), paths(&paths), budget(AnalysisBudget::Remaining(budget, cap)) {}
+};
+
+// Rough sizes, counting hash table overhead
+static const size_t CONSTANT_BYTES = 96;
+static const size_t PATH_LINK_BYTES = 40;
+
+StackSolver::StackSolver(Program &program, const SolverOptions &options)
+        : StackSolver(program, options, program.expressions, program.paths, *program.budget) {}
+
+StackSolver::StackSolver(Program &program, const SolverOptions &options, ExpressionArena &arena,
+                         ExecutionPaths &paths, AnalysisBudget &budget)
+        : program(program), options(options), arena(arena), paths(paths), budget(budget),
+          chargedConstants(arena.Size() + arena.SetCount()), chargedPaths(paths.Size()) {
+    nodes.resize(program.graph.Size());
+}
+
+CFStack StackSolver::contextOf(const CFStack &stack) const {
+    const auto& graph = program.graph;
+
+    // Keep the slots that hold jump destinations; everything else is data
+    CFStack context(stack.size(), CFExpression::Unknown());
+    for(size_t i = 0;i < stack.size();i++) {
+        auto& slot = stack[i];
+        if(!slot.isConstant() && !slot.isConstantSet())
+            continue;
+
+        bool isJumpDest = true;
+        auto members = arena.MembersBegin(slot);
+        for(size_t m = 0;m < arena.MemberCount(slot) && isJumpDest;m++) {
+            int64_t offset = 0;
+            auto node = arena.GetConstantInt(members[m], &offset) ? graph.IndexAt(offset) : CFGraph::npos;
+            isJumpDest = node != CFGraph::npos && graph[node].isJumpDest;
+        }
+        if(isJumpDest)
+            context[i] = slot;
+    }
+    return context;
+}
+
+CFStack StackSolver::join(const CFStack &a, const CFStack &b, bool widen) {
+    // Stacks line up at the top; slots below the shorter one are dropped
+    auto height = std::min(a.size(), b.size());
+    CFStack rtn(height);
+    auto aBottom = a.size() - height, bBottom = b.size() - height;
+    for(size_t i = 0;i < height;i++) {
+        auto& old = a[aBottom + i];
+        auto joined = arena.Join(old, b[bBottom + i], options.maxConstantSet);
+        if(widen && joined != old)
+            joined = CFExpression::Unknown();
+        rtn[i] = joined;
+    }
+    return rtn;
+}
+
+void StackSolver::addPath(State &state, executionPath path) const {
+    if(state.paths.size() < options.maxPathsPerState &&
+       std::find(state.paths.begin(), state.paths.end(), path) == state.paths.end())
+        state.paths.push_back(path);
+}
+
+void StackSolver::addPaths(State &state, const std::vector<executionPath> &incoming, size_t from) {
+    for(auto& path : incoming) {
+        if(state.paths.size() >= options.maxPathsPerState)
+            return;
+        addPath(state, paths.Extend(path, from));
+    }
+}
+
+void StackSolver::queue(size_t node) {
+    if(nodes[node].isQueued)
+        return;
+    nodes[node].isQueued = true;
+    worklist.push_back((uint32_t)node);
+    std::push_heap(worklist.begin(), worklist.end(), std::greater<uint32_t>());
+}
+
+void StackSolver::queuePaths(size_t node, const State &state) {
+    if(state.isEvaluated && state.pathsSent < state.paths.size())
+        queue(node);
+}
+
+bool StackSolver::charge() {
+    auto constants = arena.Size() + arena.SetCount();
+    auto newPaths = paths.Size() - chargedPaths;
+    budget.Charge(AnalysisBudget::PATHS, newPaths);
+    budget.Charge(AnalysisBudget::BYTES, newPaths * PATH_LINK_BYTES + (constants - chargedConstants) * CONSTANT_BYTES);
+    chargedConstants = constants;
+    chargedPaths = paths.Size();
+    return !budget.IsExhausted();
+}
+
+void StackSolver::foldConstantSets(const OpCodes::OpCode &opCode, Span<const CFExpression> operands,
+                                   CFStack &scratch, CFExpression &output) const {
+
+    size_t combinations = 1;
+    bool hasSet = false;
+    for(auto& op : operands) {
+        if(!op.isConstant() && !op.isConstantSet())
+            return;
+        hasSet |= op.isConstantSet();
+        combinations *= arena.MemberCount(op);
+        if(combinations > options.maxConstantSet)
+            return;
+    }
+    if(!hasSet)
+        return;
+
+    scratch.clear();
+    size_t choice[3] = {0, 0, 0};
+    uint256 inputs[3];
+    assert(operands.size() <= 3);
+    for(size_t n = 0;n < combinations;n++) {
+        for(size_t i = 0;i < operands.size();i++)
+            inputs[i] = arena.Value(arena.MembersBegin(operands[i])[choice[i]]);
+        scratch.push_back(arena.Constant(opCode.Solve(inputs)));
+
+        for(size_t i = 0;i < operands.size();i++) {
+            if(++choice[i] < arena.MemberCount(operands[i]))
+                break;
+            choice[i] = 0;
+        }
+    }
+    output = arena.ConstantSet(scratch);
+}
+
+void StackSolver::transfer(size_t node, const CFStack &entry, BlockExit &exit) const {
+    const auto& store = program.instructions;
+    const auto& block = program.graph[node];
+
+    auto& stack = exit.stack;
+    stack.assign(entry.begin(), entry.end());
+    exit.jumps.clear();
+
+    // Large enough for SWAP16 and DUP16
+    CFExpression operands[17], outputs[17];
+    size_t argumentIdx = 0;
+    for(size_t idx = block.first;idx < block.last;idx++) {
+        auto& opCode = store.OpCodeAt(idx);
+        assert(opCode.stackRemoved <= 17 && opCode.stackAdded <= 17);
+
+        for(size_t i = 0;i < opCode.stackRemoved;i++) {
+            if(stack.empty()) {
+                operands[i] = CFExpression::Argument(argumentIdx++);
+            } else {
+                operands[i] = stack.back();
+                stack.pop_back();
+            }
+        }
+
+        // Outputs default to what the straight line pass named them, which is
+        // what the disassembly shows
+        auto named = store.Outputs(idx);
+        std::copy(named.begin(), named.end(), outputs);
+
+        Span<const CFExpression> in(operands, opCode.stackRemoved);
+        Span<CFExpression> out(outputs, opCode.stackAdded);
+        if(opCode.isArithmetic())
+            foldConstantSets(opCode, in, exit.scratch, out[0]);
+        CFInstruction::simplify(arena, opCode, in, out);
+        for(size_t i = out.size();i-- > 0;) {
+            stack.push_back(out[i]);
+        }
+
+        if(opCode.isBranch())
+            exit.jumps.push_back({store.Offset(idx), in.front()});
+    }
+
+    exit.fallsThrough = block.last > block.first && store.OpCodeAt(block.last - 1).isFallThrough();
+}
+
+void StackSolver::successorsOf(size_t node, const BlockExit &exit, std::vector<size_t> &successors) {
+    const auto& graph = program.graph;
+
+    successors.clear();
+    for(auto& jump : exit.jumps) {
+        int64_t jumpLoc = 0;
+        if(arena.GetConstantInt(jump.target, &jumpLoc)) {
+            auto to = graph.IndexAt(jumpLoc);
+            if(to == CFGraph::npos)
+                continue;
+            if(graph[to].isJumpDest) {
+                edges.emplace((uint32_t)node, (uint32_t)to);
+                successors.push_back(to);
+            } else {
+                invalidJumps.emplace(std::make_pair(jump.offset, to), node);
+            }
+        } else if(jump.target.isConstantSet()) {
+            auto members = arena.MembersBegin(jump.target);
+            for(size_t m = 0;m < arena.MemberCount(jump.target);m++) {
+                auto to = arena.GetConstantInt(members[m], &jumpLoc) ? graph.IndexAt(jumpLoc) : CFGraph::npos;
+                // Members may be data that merely shares a slot; drop them
+                if(to != CFGraph::npos && graph[to].isJumpDest) {
+                    edges.emplace((uint32_t)node, (uint32_t)to);
+                    successors.push_back(to);
+                }
+            }
+        } else {
+            unresolvedJumps.insert(jump.offset);
+        }
+    }
+
+    if(exit.fallsThrough) {
+        auto next = graph.IndexAt(graph[node].end);
+        if(next != CFGraph::npos)
+            successors.push_back(next);
+    }
+}
+
+void StackSolver::addFlowEdge(size_t from, size_t to) {
+    auto& next = nodes[from].flowNext;
+    if(std::find(next.begin(), next.end(), to) != next.end())
+        return;
+    if(next.empty())
+        flowBlocks.push_back((uint32_t)from);
+    next.push_back((uint32_t)to);
+
+    // Still a depth first numbering if the edge is one a search could have
+    // left there: to an ancestor, a descendant, or a block already finished
+    auto& a = nodes[from];
+    auto& b = nodes[to];
+    if(isOrderStale || a.preorder == NO_ORDER || b.preorder == NO_ORDER) {
+        isOrderStale = true;
+        return;
+    }
+    bool isAncestor = b.preorder <= a.preorder && a.postorder <= b.postorder;
+    bool isDescendant = a.preorder <= b.preorder && b.postorder <= a.postorder;
+    isOrderStale = !isAncestor && !isDescendant && b.postorder > a.postorder;
+}
+
+void StackSolver::numberFlow() {
+    for(auto root : roots)
+        nodes[root].preorder = nodes[root].postorder = NO_ORDER;
+    for(auto i : flowBlocks) {
+        for(auto to : nodes[i].flowNext)
+            nodes[to].preorder = nodes[to].postorder = NO_ORDER;
+    }
+    uint32_t pre = 0, post = 0;
+    // (block, next successor to look at)
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+
+    auto search = [&](uint32_t root) {
+        if(nodes[root].preorder != NO_ORDER)
+            return;
+        nodes[root].preorder = pre++;
+        stack.emplace_back(root, 0);
+        while(!stack.empty()) {
+            auto& top = stack.back();
+            auto& next = nodes[top.first].flowNext;
+            if(top.second < next.size()) {
+                auto to = next[top.second++];
+                if(nodes[to].preorder == NO_ORDER) {
+                    nodes[to].preorder = pre++;
+                    stack.emplace_back(to, 0);
+                }
+            } else {
+                nodes[top.first].postorder = post++;
+                stack.pop_back();
+            }
+        }
+    };
+    for(auto root : roots)
+        search(root);
+    // States merged in from functions flow from blocks no root reaches here
+    for(auto i : flowBlocks)
+        search(i);
+    isOrderStale = false;
+}
+
+bool StackSolver::isRetreating(size_t from, size_t to) {
+    if(from == to)
+        return true;
+    if(isOrderStale)
+        numberFlow();
+    auto& a = nodes[from];
+    auto& b = nodes[to];
+    return b.preorder <= a.preorder && a.postorder <= b.postorder;
+}
+
+void StackSolver::propagate(size_t from, size_t to, const CFStack &stack, const std::vector<executionPath> &incoming) {
+    addFlowEdge(from, to);
+    if(isDeferring && isFunctionEntry[to]) {
+        auto& held = deferred[to];
+        for(auto& state : held) {
+            if(state.entry == stack) {
+                addPaths(state, incoming, from);
+                return;
+            }
+        }
+        held.emplace_back();
+        held.back().entry = stack;
+        addPaths(held.back(), incoming, from);
+        return;
+    }
+
+    for(auto& state : nodes[to].states) {
+        if(state.entry == stack) {
+            addPaths(state, incoming, from);
+            queuePaths(to, state);
+            return;
+        }
+    }
+
+    State state;
+    state.entry = stack;
+    addPaths(state, incoming, from);
+    insert(to, std::move(state), from);
+}
+
+void StackSolver::insert(size_t to, State &&incoming, size_t from) {
+    auto& target = nodes[to];
+
+    for(auto& state : target.states) {
+        if(state.entry == incoming.entry) {
+            for(auto p : incoming.paths)
+                addPath(state, p);
+            queuePaths(to, state);
+            return;
+        }
+    }
+
+    auto context = contextOf(incoming.entry);
+    for(auto& state : target.states) {
+        if(!target.isStateCapped && state.context != context)
+            continue;
+
+        // Coming back around to a block we already passed through. Only
+        // asked here, as the flow numbering may have to be redone.
+        bool isBackEdge = from != NO_EDGE && isRetreating(from, to);
+        if(isBackEdge)
+            target.isWidened = true;
+        for(auto p : incoming.paths)
+            addPath(state, p);
+        queuePaths(to, state);
+        auto joined = join(state.entry, incoming.entry, isBackEdge);
+        if(joined != state.entry) {
+            state.entry = std::move(joined);
+            state.context = contextOf(state.entry);
+            state.isDirty = true;
+            queue(to);
+        }
+        return;
+    }
+
+    if(target.states.size() < options.maxStatesPerNode) {
+        budget.Charge(AnalysisBudget::STATES, 1);
+        budget.Charge(AnalysisBudget::BYTES, sizeof(State) + (incoming.entry.size() * 3 + incoming.paths.size()) * 4);
+
+        // A state merged in from a function comes with its exit already
+        // worked out, and stays clean
+        incoming.context = std::move(context);
+        if(incoming.isDirty)
+            queue(to);
+        target.states.push_back(std::move(incoming));
+        return;
+    }
+
+    // Too many contexts; fold them all into one state from here on
+    target.isStateCapped = true;
+    State merged = std::move(incoming);
+    for(auto& state : target.states) {
+        merged.entry = join(merged.entry, state.entry, false);
+        for(auto p : state.paths)
+            addPath(merged, p);
+    }
+    merged.context = contextOf(merged.entry);
+    merged.isDirty = true;
+    target.states.clear();
+    target.states.push_back(std::move(merged));
+    queue(to);
+}
+
+void StackSolver::run() {
+    BlockExit exit;
+    std::vector<size_t> successors;
+    while(!worklist.empty() && charge()) {
+        // Lowest offset first, which mostly follows the code's own order
+        std::pop_heap(worklist.begin(), worklist.end(), std::greater<uint32_t>());
+        auto node = worklist.back();
+        worklist.pop_back();
+        nodes[node].isQueued = false;
+
+        for(size_t i = 0;i < nodes[node].states.size();i++) {
+            auto& state = nodes[node].states[i];
+            if(state.isDirty) {
+                state.isDirty = false;
+                transfer(node, state.entry, exit);
+                evaluations++;
+                // Successors follow from the exit alone, so if it came out
+                // the same they already have it and nothing downstream is
+                // dirtied; only paths they haven't seen are sent on
+                if(!state.isEvaluated || state.exit != exit.stack) {
+                    state.exit = exit.stack;
+                    state.isEvaluated = true;
+                    successorsOf(node, exit, successors);
+                    state.successors.assign(successors.begin(), successors.end());
+                    state.pathsSent = 0;
+                }
+            }
+            if(state.pathsSent == state.paths.size())
+                continue;
+
+            // propagate can grow this node's states when it loops to itself
+            exit.stack = state.exit;
+            successors.assign(state.successors.begin(), state.successors.end());
+            std::vector<executionPath> statePaths(state.paths.begin() + state.pathsSent, state.paths.end());
+            state.pathsSent = state.paths.size();
+            for(auto next : successors) {
+                propagate(node, next, exit.stack, statePaths);
+            }
+        }
+    }
+    isComplete &= worklist.empty();
+}
+
+void StackSolver::findFunctionEntries() {
+    const auto& store = program.instructions;
+    const auto& graph = program.graph;
+
+    // A selector compare: a JUMPI taken when something equals a pushed four
+    // byte constant. Its target is where that function starts.
+    isFunctionEntry.assign(graph.Size(), false);
+    for(auto& node : graph) {
+        if(node.last == node.first || store.OpCodeAt(node.last - 1).opCode != OpCodes::OP_JUMPI)
+            continue;
+
+        bool comparesSelector = false;
+        for(size_t idx = node.first;idx < node.last && !comparesSelector;idx++) {
+            if(store.OpCodeAt(idx).opCode != OpCodes::OP_EQ)
+                continue;
+            for(auto& op : store.Operands(idx)) {
+                comparesSelector |= op.isConstant() && arena.Length(op) == 4;
+            }
+        }
+
+        int64_t target = 0;
+        if(!comparesSelector || !arena.GetConstantInt(store.Operands(node.last - 1).front(), &target))
+            continue;
+        auto to = graph.IndexAt(target);
+        // The entry block itself starts the program; never hold it back
+        if(to != CFGraph::npos && to != 0 && graph[to].isJumpDest)
+            isFunctionEntry[to] = true;
+    }
+}
+
+void StackSolver::solveFunction(Function &function) const {
+    function.solver.reset(new StackSolver(program, options, function.arena, function.paths, function.budget));
+    auto& solver = *function.solver;
+    solver.roots.push_back((uint32_t)function.entry);
+    for(auto& seed : function.seeds) {
+        solver.insert(function.entry, std::move(seed), NO_EDGE);
+    }
+    solver.run();
+    solver.charge();
+
+    // Most of the graph is some other function's; don't hold on to it
+    for(size_t i = 0;i < solver.nodes.size();i++) {
+        auto& node = solver.nodes[i];
+        if(!node.states.empty())
+            function.blocks.push_back((uint32_t)i);
+        if(!node.states.empty() || node.isWidened || node.isStateCapped)
+            function.results.emplace_back(i, std::move(node));
+    }
+    solver.nodes = std::vector<NodeStates>();
+}
+
+void StackSolver::merge(Function &function) {
+    auto& solver = *function.solver;
+    std::vector<executionPath> pathMemo;
+
+    for(auto& result : function.results) {
+        auto i = result.first;
+        nodes[i].isWidened |= result.second.isWidened;
+        nodes[i].isStateCapped |= result.second.isStateCapped;
+
+        for(auto& state : result.second.states) {
+            for(auto& e : state.entry)
+                e = arena.Import(function.arena, e);
+            for(auto& e : state.exit)
+                e = arena.Import(function.arena, e);
+            for(auto& p : state.paths)
+                p = paths.Import(function.paths, p, pathMemo);
+            insert(i, std::move(state), NO_EDGE);
+        }
+    }
+
+    edges.insert(solver.edges.begin(), solver.edges.end());
+    invalidJumps.insert(solver.invalidJumps.begin(), solver.invalidJumps.end());
+    unresolvedJumps.insert(solver.unresolvedJumps.begin(), solver.unresolvedJumps.end());
+    isComplete &= solver.isComplete;
+    evaluations += solver.evaluations;
+    // Whatever stopped the function stops the program too, unless it was
+    // the function's own cap
+    for(size_t r = 0;r < AnalysisBudget::RESOURCE_COUNT;r++) {
+        auto resource = (AnalysisBudget::Resource)r;
+        if(function.budget.IsExhausted(resource) && !function.budget.IsCapped(resource))
+            budget.Exhaust(resource);
+    }
+    auto& solved = program.solvedFunctions[function.entry];
+    solved.blocks = std::move(function.blocks);
+    solved.isTruncated = !solver.isComplete;
+    function.solver.reset();
+    function.results.clear();
+}
+
+void StackSolver::solveFunctions() {
+    std::vector<std::unique_ptr<Function>> functions;
+    for(auto& entry : deferred) {
+        functions.emplace_back(new Function(arena, paths, budget, options.functionBudget));
+        functions.back()->entry = entry.first;
+        functions.back()->seeds = std::move(entry.second);
+    }
+    deferred.clear();
+
+    auto solveOne = [&](size_t i) { solveFunction(*functions[i]); };
+    if(options.pool && functions.size() > 1) {
+        options.pool->ParallelFor(functions.size(), solveOne);
+    } else {
+        for(size_t i = 0;i < functions.size();i++)
+            solveOne(i);
+    }
+
+    // Entry order, whatever order they finished in. Once the budget is
+    // spent the rest are dropped, even if they did finish.
+    size_t merged = 0;
+    for(;merged < functions.size();merged++) {
+        if(!charge()) {
+            isComplete = false;
+            break;
+        }
+        merge(*functions[merged]);
+    }
+    for(;merged < functions.size();merged++)
+        program.solvedFunctions[functions[merged]->entry].isTruncated = true;
+    charge();
+}
+
+void StackSolver::buildContexts() {
+    auto& graph = program.graph;
+    auto& contexts = program.contexts;
+    contexts.nodesAt.assign(graph.Size() + 1, 0);
+    for(size_t i = 0;i < graph.Size();i++)
+        contexts.nodesAt[i + 1] = contexts.nodesAt[i] + (uint32_t)std::max<size_t>(nodes[i].states.size(), 1);
+    contexts.nodes.assign(contexts.nodesAt.back(), ContextGraph::Node());
+
+    auto addAll = [&](std::vector<uint32_t>& next, size_t to) {
+        for(auto n = contexts.Begin(to);n < contexts.End(to);n++)
+            next.push_back((uint32_t)n);
+    };
+    // The state an exit sent to to went into: the one it joined or started
+    auto addTarget = [&](std::vector<uint32_t>& next, size_t to, const CFStack& exit) {
+        auto& target = nodes[to];
+        if(target.states.empty() || target.isStateCapped)
+            return addAll(next, to);
+        for(size_t k = 0;k < target.states.size();k++) {
+            if(target.states[k].entry == exit)
+                return next.push_back((uint32_t)(contexts.Begin(to) + k));
+        }
+        auto context = contextOf(exit);
+        for(size_t k = 0;k < target.states.size();k++) {
+            if(target.states[k].context == context)
+                return next.push_back((uint32_t)(contexts.Begin(to) + k));
+        }
+        addAll(next, to);
+    };
+
+    for(size_t i = 0;i < graph.Size();i++) {
+        auto& states = nodes[i].states;
+        for(auto n = contexts.Begin(i);n < contexts.End(i);n++) {
+            auto& node = contexts.nodes[n];
+            node.block = (uint32_t)i;
+            auto k = n - contexts.Begin(i);
+            if(states.empty() || !states[k].isEvaluated) {
+                for(auto to : graph.Next(i))
+                    addAll(node.next, to);
+            } else {
+                for(auto to : states[k].successors)
+                    addTarget(node.next, to, states[k].exit);
+            }
+            std::sort(node.next.begin(), node.next.end());
+            node.next.erase(std::unique(node.next.begin(), node.next.end()), node.next.end());
+        }
+    }
+}
+
+bool StackSolver::Solve() {
+    auto& graph = program.graph;
+    if(graph.Empty())
+        return true;
+
+    findFunctionEntries();
+
+    roots.push_back(0);
+    State root;
+    root.paths.push_back(ExecutionPaths::EMPTY);
+    nodes[0].states.push_back(std::move(root));
+    queue(0);
+
+    isDeferring = true;
+    run();
+    isDeferring = false;
+    if(budget.IsExhausted()) {
+        isComplete &= deferred.empty();
+        for(auto& entry : deferred)
+            program.solvedFunctions[entry.first].isTruncated = true;
+    } else {
+        solveFunctions();
+    }
+    run();
+
+    for(auto& edge : edges)
+        graph.AddEdge(edge.first, edge.second);
+    buildContexts();
+    for(auto& jump : invalidJumps)
+        program.addInvalidJump(jump.second, jump.first.first, jump.first.second);
+    program.unresolvedJumps.insert(unresolvedJumps.begin(), unresolvedJumps.end());
+    program.blockEvaluations = evaluations;
+
+    for(size_t i = 0;i < graph.Size();i++) {
+        auto& node = graph[i];
+        node.isWidened = nodes[i].isWidened;
+        node.isStateCapped = nodes[i].isStateCapped;
+        node.possibleEntryStackStates.clear();
+        node.possibleExitStackStates.clear();
+        for(auto& state : nodes[i].states) {
+            auto& entryPaths = node.possibleEntryStackStates[state.entry];
+            entryPaths.insert(entryPaths.end(), state.paths.begin(), state.paths.end());
+            auto& exitPaths = node.possibleExitStackStates[state.exit];
+            exitPaths.insert(exitPaths.end(), state.paths.begin(), state.paths.end());
+        }
+    }
+
+    return isComplete;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "AnalysisBudget.h"
+#include "CFExpression.h"
+#include "CFNode.h"
+#include "ExecutionPaths.h"
+#include "OpCodes.h"
+#include "Span.h"
+
+class Program;
+class ThreadPool;
+
+struct SolverOptions {
+    // Distinct entry states (calling contexts) kept per block; past this
+    // they are all joined into one
+    size_t maxStatesPerNode = 32;
+    // Constants a stack slot may hold before it becomes unknown
+    size_t maxConstantSet = 8;
+    // Example paths recorded per state for the stack report
+    size_t maxPathsPerState = 4;
+    // Where the dispatcher's functions are solved side by side; null solves
+    // them one after another. The results are the same either way.
+    ThreadPool* pool = nullptr;
+    // Shared by a contract and everything it creates
+    AnalysisBudget::Limits budget;
+    // Further limits each dispatcher function; one that runs out is cut
+    // short on its own and the rest go on
+    AnalysisBudget::Limits functionBudget;
+
+    // Mixed into cache keys, since the options change the results
+    std::string Fingerprint() const;
+};
+
+/***
+ * Worklist abstract interpretation of a program's stack, run once from the
+ * entry block to a fixed point. Besides the per block entry and exit states
+ * it resolves jumps, adding any edge it finds to the program's graph.
+ *
+ * A block keeps one entry state per calling context, a context being the
+ * jump destinations on the stack (return addresses, mostly). States in the
+ * same context are joined slot by slot. When a state comes back around a
+ * loop the block is a loop head and the join widens: any slot that still
+ * changes goes straight to unknown. Together with the per block state cap
+ * and the constant set limit this bounds both time and memory.
+ *
+ * The public functions behind the selector dispatcher are mostly
+ * independent, so the solve is split there. The dispatcher is solved first
+ * with the function entries held back; each function is then solved from
+ * the states that reached its entry, with its own arena and paths layered
+ * over the program's, and possibly on other threads. Their results are merged back in
+ * entry order, and a last pass settles whatever the merge joined.
+ *
+ * The solve stops wherever it is once the program's budget runs out. Each
+ * function is given what was left when the functions started and charges
+ * the program only when merged, so a count limit cuts at the same place
+ * however the functions were scheduled. Where functionBudget is tighter,
+ * running out of it stops that function alone.
+ */
+class StackSolver {
+    struct State {
+        CFStack entry, exit;
+        // entry with everything but jump destinations blanked out
+        CFStack context;
+        std::vector<executionPath> paths;
+        bool isDirty = true;
+        // Whether exit has been worked out and sent on to the successors
+        bool isEvaluated = false;
+        // Where exit was sent, and how many of paths went along with it
+        std::vector<uint32_t> successors;
+        size_t pathsSent = 0;
+    };
+    // What one pass over a block gave for one entry state. Kept around and
+    // reused, so after warming up a pass allocates nothing.
+    struct BlockExit {
+        CFStack stack;
+        struct Jump {
+            size_t offset;
+            CFExpression target;
+        };
+        std::vector<Jump> jumps;
+        bool fallsThrough = false;
+        CFStack scratch;
+    };
+    static constexpr uint32_t NO_ORDER = UINT32_MAX;
+    struct NodeStates {
+        std::vector<State> states;
+        bool isQueued = false;
+        bool isWidened = false;
+        bool isStateCapped = false;
+        // Blocks states were sent on to, and the block's place in a depth
+        // first search over those edges
+        std::vector<uint32_t> flowNext;
+        uint32_t preorder = NO_ORDER, postorder = NO_ORDER;
+    };
+    struct Function;
+
+    Program& program;
+    const SolverOptions& options;
+    // The program's own, or a function's layered over them
+    ExpressionArena& arena;
+    ExecutionPaths& paths;
+    AnalysisBudget& budget;
+    // Arena and path sizes already charged to the budget
+    size_t chargedConstants = 0, chargedPaths = 0;
+    // Cleared when the budget cuts the solve short
+    bool isComplete = true;
+    // Passes over a block, one per dirty state
+    size_t evaluations = 0;
+    std::vector<NodeStates> nodes;
+    std::vector<uint32_t> worklist;
+
+    // Entries of the dispatcher's functions, and the states that reached
+    // them while the dispatcher was being solved
+    std::vector<bool> isFunctionEntry;
+    std::map<size_t, std::vector<State>> deferred;
+    bool isDeferring = false;
+
+    // Found while solving; only written to the program once all is done
+    std::set<std::pair<uint32_t, uint32_t>> edges;
+    // (jump offset, target node) to the node the jump was seen in
+    std::map<std::pair<size_t, size_t>, size_t> invalidJumps;
+    std::set<size_t> unresolvedJumps;
+
+    // Edges states were sent along are numbered depth first from the roots;
+    // an edge to an ancestor goes back around a loop. The numbering is
+    // redone only when a new edge does not fit it.
+    std::vector<uint32_t> roots;
+    // Blocks with an edge out, in the order they got it
+    std::vector<uint32_t> flowBlocks;
+    bool isOrderStale = true;
+    void addFlowEdge(size_t from, size_t to);
+    void numberFlow();
+    bool isRetreating(size_t from, size_t to);
+
+    StackSolver(Program& program, const SolverOptions& options, ExpressionArena& arena, ExecutionPaths& paths,
+                AnalysisBudget& budget);
+
+    CFStack contextOf(const CFStack& stack) const;
+    CFStack join(const CFStack& a, const CFStack& b, bool widen);
+    void addPath(State& state, executionPath path) const;
+    void addPaths(State& state, const std::vector<executionPath>& paths, size_t from);
+    void queue(size_t node);
+    // Queues node if state has paths its successors haven't had yet
+    void queuePaths(size_t node, const State& state);
+    // Charges whatever the arena and paths grew by since last time
+    bool charge();
+    void foldConstantSets(const OpCodes::OpCode& opCode, Span<const CFExpression> operands,
+                          CFStack& scratch, CFExpression& output) const;
+
+    // Evaluates a block against entry. Reads the instruction store and
+    // touches nothing shared except interning constants in the arena.
+    void transfer(size_t node, const CFStack& entry, BlockExit& exit) const;
+    void successorsOf(size_t node, const BlockExit& exit, std::vector<size_t>& successors);
+    void propagate(size_t from, size_t to, const CFStack& stack, const std::vector<executionPath>& paths);
+    static constexpr size_t NO_EDGE = (size_t)-1;
+    // Adds incoming, sent along from -> to (NO_EDGE for seeds and merges),
+    // to the node's states: kept as is if its entry is new in its context,
+    // otherwise joined into the state it shares a context with, and widened
+    // if the edge goes back around a loop
+    void insert(size_t to, State&& incoming, size_t from);
+    void run();
+    // Fills in the program's ContextGraph from the final states
+    void buildContexts();
+
+    void findFunctionEntries();
+    void solveFunction(Function& function) const;
+    void merge(Function& function);
+    void solveFunctions();
+public:
+    StackSolver(Program& program, const SolverOptions& options);
+
+    // Runs to a fixed point, or until the budget runs out, and stores the
+    // states into the program's nodes. Returns false if it was cut short.
+    bool Solve();
+};
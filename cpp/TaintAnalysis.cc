@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <algorithm>
+#include "TaintAnalysis.h"
+#include "Program.h"
+
+static const TaintAnalysis::Sink sinks[] = {
+        { OpCodes::OP_SSTORE, 0, TaintAnalysis::STORAGE_KEY },
+        { OpCodes::OP_SSTORE, 1, TaintAnalysis::STORED_VALUE },
+        { OpCodes::OP_JUMPI, 1, TaintAnalysis::BRANCH_CONDITION },
+        { OpCodes::OP_CALL, 1, TaintAnalysis::CALL_TARGET },
+        { OpCodes::OP_CALL, 2, TaintAnalysis::CALL_VALUE },
+        { OpCodes::OP_CALLCODE, 1, TaintAnalysis::CALL_TARGET },
+        { OpCodes::OP_CALLCODE, 2, TaintAnalysis::CALL_VALUE },
+        { OpCodes::OP_DELEGATECALL, 1, TaintAnalysis::CALL_TARGET },
+        { OpCodes::OP_SUICIDE, 0, TaintAnalysis::BENEFICIARY },
+};
+
+Span<const TaintAnalysis::Sink> TaintAnalysis::Sinks() {
+    return Span<const Sink>(sinks, sizeof(sinks) / sizeof(sinks[0]));
+}
+
+static TaintAnalysis::Taint sourceOf(uint8_t opCode) {
+    switch(opCode) {
+        case OpCodes::OP_CALLER: return TaintAnalysis::CALLER;
+        case OpCodes::OP_ORIGIN: return TaintAnalysis::ORIGIN;
+        case OpCodes::OP_CALLDATALOAD: return TaintAnalysis::CALLDATA;
+        case OpCodes::OP_CALLVALUE: return TaintAnalysis::CALLVALUE;
+        case OpCodes::OP_SLOAD: return TaintAnalysis::STORAGE;
+        default: return 0;
+    }
+}
+
+// What these read is not their operands' data
+static bool isLoad(uint8_t opCode) {
+    return opCode == OpCodes::OP_SLOAD || opCode == OpCodes::OP_MLOAD || opCode == OpCodes::OP_SHA3 ||
+           opCode == OpCodes::OP_CALLDATALOAD;
+}
+
+TaintAnalysis::TaintAnalysis(const Program &program) : ssa(&program.SSA()) {
+    auto& store = program.Store();
+    auto& graph = program.Graph();
+    auto& expressions = program.Expressions();
+    taint.assign(ssa->Size(), 0);
+
+    // Output value of each instruction, or NONE
+    std::vector<SSAForm::Value> outputOf(store.Size(), SSAForm::NONE);
+    // Words stored before an MLOAD or SHA3 in the same block, as
+    // (stored value, reading value) pairs
+    std::vector<std::pair<SSAForm::Value, SSAForm::Value>> memoryEdges;
+    // Constant address and value of each MSTORE so far in the block
+    std::vector<std::pair<int64_t, SSAForm::Value>> stored;
+    // Memory a CALLDATACOPY wrote in the block, as [first, last)
+    std::vector<std::pair<int64_t, int64_t>> copied;
+
+    for(auto& node : graph) {
+        stored.clear();
+        copied.clear();
+        for(size_t i = node.first;i < node.last;i++) {
+            auto& opCode = store.OpCodeAt(i);
+            if(opCode.isStackManipulatorOnly())
+                continue;
+            auto operands = store.Operands(i);
+            auto values = ssa->Operands(i);
+
+            int64_t address = 0, size = 0;
+            bool isConstantAddress = !operands.empty() && expressions.GetConstantInt(operands[0], &address);
+            if(opCode.opCode == OpCodes::OP_MSTORE || opCode.opCode == OpCodes::OP_MSTORE8) {
+                // Anything stored at an unknown address may have overwritten
+                // what was stored before
+                if(!isConstantAddress)
+                    stored.clear();
+                else
+                    stored.emplace_back(address, values[1]);
+                continue;
+            }
+            // Copies and call outputs, as in Program::foldMemory
+            if(opCode.clobbersMemory())
+                stored.clear();
+            if(opCode.opCode == OpCodes::OP_CALLDATACOPY) {
+                if(isConstantAddress && expressions.GetConstantInt(operands[2], &size))
+                    copied.emplace_back(address, address + size);
+                else
+                    copied.emplace_back(INT64_MIN, INT64_MAX);
+                continue;
+            }
+
+            auto outputs = store.Outputs(i);
+            if(outputs.empty() || !outputs[0].isSymbolic())
+                continue;
+            auto v = ssa->OfSymbol(outputs[0].idx());
+            if(v == SSAForm::NONE)
+                continue;
+            outputOf[i] = v;
+            taint[v] |= sourceOf(opCode.opCode);
+
+            if(!isConstantAddress)
+                continue;
+            // Call data copied over what is read; a word stored whole since
+            // hides it
+            auto readsCopy = [&](int64_t first, int64_t last) {
+                return std::any_of(copied.begin(), copied.end(), [&](const std::pair<int64_t, int64_t>& copy) {
+                    return copy.first < last && first < copy.second;
+                });
+            };
+            if(opCode.opCode == OpCodes::OP_MLOAD) {
+                // The last word stored there, if it was stored whole
+                auto it = std::find_if(stored.rbegin(), stored.rend(), [&](const std::pair<int64_t, SSAForm::Value>& word) {
+                    return word.first == address;
+                });
+                if(it != stored.rend())
+                    memoryEdges.emplace_back(it->second, v);
+                else if(readsCopy(address, address + 32))
+                    taint[v] |= CALLDATA;
+            } else if(opCode.opCode == OpCodes::OP_SHA3 && expressions.GetConstantInt(operands[1], &size)) {
+                for(auto& word : stored) {
+                    if(word.first + 32 > address && word.first < address + size)
+                        memoryEdges.emplace_back(word.second, v);
+                }
+                if(readsCopy(address, address + size))
+                    taint[v] |= CALLDATA;
+            }
+        }
+    }
+
+    std::sort(memoryEdges.begin(), memoryEdges.end());
+    std::vector<uint32_t> memoryAt(ssa->Size() + 1, 0);
+    for(auto& edge : memoryEdges)
+        memoryAt[edge.first + 1]++;
+    for(size_t v = 0;v < ssa->Size();v++)
+        memoryAt[v + 1] += memoryAt[v];
+
+    std::vector<SSAForm::Value> work;
+    std::vector<bool> isQueued(ssa->Size());
+    for(size_t v = 0;v < ssa->Size();v++) {
+        if(taint[v]) {
+            isQueued[v] = true;
+            work.push_back((SSAForm::Value)v);
+        }
+    }
+
+    auto spread = [&](SSAForm::Value to, Taint t) {
+        if(to == SSAForm::NONE || (taint[to] | t) == taint[to])
+            return;
+        taint[to] |= t;
+        if(!isQueued[to]) {
+            isQueued[to] = true;
+            work.push_back(to);
+        }
+    };
+    while(!work.empty()) {
+        auto v = work.back();
+        work.pop_back();
+        isQueued[v] = false;
+        auto t = taint[v];
+
+        for(auto& use : ssa->Uses(v)) {
+            if(use.isPhi)
+                spread(use.user, t);
+            else if(!isLoad(store.OpCodeAt(use.user).opCode))
+                spread(outputOf[use.user], t);
+        }
+        for(auto e = memoryAt[v];e < memoryAt[v + 1];e++)
+            spread(memoryEdges[e].second, t);
+    }
+}
+
+TaintAnalysis::Taint TaintAnalysis::OfOperand(size_t instruction, size_t operand) const {
+    assert(ssa);
+    auto v = ssa->Operands(instruction)[operand];
+    return v == SSAForm::NONE ? 0 : Of(v);
+}
+
+TaintAnalysis::Taint TaintAnalysis::OfSink(size_t instruction, uint8_t opCode, SinkKind kind) const {
+    Taint t = 0;
+    for(auto& sink : Sinks()) {
+        if(sink.opCode == opCode && sink.kind == kind)
+            t |= OfOperand(instruction, sink.operand);
+    }
+    return t;
+}
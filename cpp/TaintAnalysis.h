@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "SSAForm.h"
+#include "Span.h"
+
+class Program;
+
+/***
+ * Which untrusted inputs each SSA value is computed from, as a bitset per
+ * value, built once per program and shared by every detector.
+ *
+ * A value is tainted by its own source, if it is one, and by everything
+ * it is computed from: its operands, the incoming values of a phi, and for
+ * MLOAD and SHA3 the words stored to memory at constant addresses earlier
+ * in the same block, or the call data a CALLDATACOPY put there. Anything
+ * else that writes memory forgets those words. Loads do not pass on the
+ * taint of their address, or balances[msg.sender] would look like it held
+ * msg.sender. Taint only grows, so a worklist over the SSA use lists
+ * reaches the fixed point with each value revisited at most once per
+ * source.
+ *
+ * Only data flow is followed; a value chosen by a tainted branch is not
+ * itself tainted.
+ */
+class TaintAnalysis {
+public:
+    typedef uint8_t Taint;
+    enum Source : Taint {
+        CALLER = 1 << 0,
+        ORIGIN = 1 << 1,
+        CALLDATA = 1 << 2,
+        CALLVALUE = 1 << 3,
+        STORAGE = 1 << 4
+    };
+
+    enum SinkKind : uint8_t {
+        STORAGE_KEY,
+        STORED_VALUE,
+        BRANCH_CONDITION,
+        CALL_TARGET,
+        CALL_VALUE,
+        BENEFICIARY
+    };
+    // An operand where tainted input is worth a look
+    struct Sink {
+        uint8_t opCode;
+        uint8_t operand;
+        SinkKind kind;
+    };
+    // SSTORE keys and values, JUMPI conditions, the targets of CALL,
+    // CALLCODE and DELEGATECALL and the values of the first two, and
+    // SUICIDE beneficiaries
+    static Span<const Sink> Sinks();
+
+    TaintAnalysis() = default;
+    // program's SSA form must be built
+    explicit TaintAnalysis(const Program& program);
+
+    Taint Of(SSAForm::Value v) const { return v < taint.size() ? taint[v] : 0; }
+    // Taint of what instruction reads as operand
+    Taint OfOperand(size_t instruction, size_t operand) const;
+    // Taint reaching instruction's sinks of kind; none if it has none
+    Taint OfSink(size_t instruction, uint8_t opCode, SinkKind kind) const;
+private:
+    const SSAForm* ssa = nullptr;
+    std::vector<Taint> taint;
+};
@@ -0,0 +1,153 @@
+#include "ThreadPool.h"
+
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(size_t threadCount) : queued(0) {
+    if(threadCount == 0)
+        threadCount = 1;
+
+    for(size_t i = 0;i < threadCount;i++)
+        queues.emplace_back(new WorkQueue());
+
+    for(size_t i = 0;i < threadCount;i++)
+        threads.emplace_back([this, i] { run(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> l(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    for(auto& t : threads)
+        t.join();
+}
+
+size_t ThreadPool::DefaultThreadCount() {
+    auto n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> l(lock);
+        size_t target = currentPool == this ? currentWorker : nextQueue++ % queues.size();
+
+        // Count before publishing so a thief can never drive 'queued' below zero
+        pending++;
+        queued++;
+
+        std::lock_guard<std::mutex> ql(queues[target]->lock);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    changed.notify_all();
+}
+
+bool ThreadPool::pop(size_t self, std::function<void()> &task) {
+    for(size_t i = 0;i < queues.size();i++) {
+        auto& q = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> l(q.lock);
+        if(q.tasks.empty())
+            continue;
+
+        if(i == 0) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::finish() {
+    bool isIdle = false;
+    {
+        std::lock_guard<std::mutex> l(lock);
+        isIdle = --pending == 0;
+    }
+    if(isIdle)
+        changed.notify_all();
+}
+
+void ThreadPool::run(size_t self) {
+    currentPool = this;
+    currentWorker = self;
+
+    while(true) {
+        std::function<void()> task;
+        if(pop(self, task)) {
+            task();
+            finish();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> l(lock);
+        changed.wait(l, [this] { return stopping || queued > 0; });
+        if(stopping && queued == 0)
+            return;
+    }
+}
+
+void ThreadPool::Wait() {
+    size_t self = currentPool == this ? currentWorker : 0;
+    while(true) {
+        std::function<void()> task;
+        if(pop(self, task)) {
+            task();
+            finish();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> l(lock);
+        changed.wait(l, [this] { return pending == 0 || queued > 0; });
+        if(pending == 0)
+            return;
+    }
+}
+
+void ThreadPool::ParallelFor(size_t n, const std::function<void(size_t)> &fn) {
+    if(n == 0)
+        return;
+
+    // Outlives the call for helpers that only get to run after it is done
+    struct Batch {
+        const std::function<void(size_t)>* fn;
+        size_t n;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> remaining;
+        std::mutex lock;
+        std::condition_variable done;
+
+        void help() {
+            while(true) {
+                auto i = next.fetch_add(1);
+                if(i >= n)
+                    return;
+                (*fn)(i);
+                if(--remaining == 0) {
+                    // Under the lock, so the waiter can't miss it between
+                    // its check and going to sleep
+                    std::lock_guard<std::mutex> l(lock);
+                    done.notify_all();
+                }
+            }
+        }
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->fn = &fn;
+    batch->n = n;
+    batch->remaining = n;
+
+    for(size_t i = 1;i < n && i <= threads.size();i++)
+        Submit([batch] { batch->help(); });
+
+    batch->help();
+    std::unique_lock<std::mutex> l(batch->lock);
+    batch->done.wait(l, [&batch] { return batch->remaining == 0; });
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***
+ * Fixed size work-stealing thread pool. Every worker owns a deque; it pops
+ * its own work from the back and steals from the front of the others when
+ * it runs dry. Tasks submitted from inside a worker go to that worker's
+ * deque so nested work stays local.
+ */
+class ThreadPool {
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::atomic<size_t> queued;
+    size_t pending = 0;
+    size_t nextQueue = 0;
+    bool stopping = false;
+
+    bool pop(size_t self, std::function<void()>& task);
+    void finish();
+    void run(size_t self);
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(const ThreadPool&) = delete;
+
+    size_t Size() const { return threads.size(); }
+
+    void Submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. The calling thread
+    // helps drain the queues while it waits. Must not be called from a task.
+    void Wait();
+
+    // Runs fn(0) .. fn(n - 1) on the pool and returns once those have
+    // finished. Unlike Wait() this may be called from a task: the caller
+    // and the workers that pick the batch up claim indices from it until
+    // none are left, and the caller then sleeps until the last one is done.
+    // It never runs unrelated queued work while it waits.
+    void ParallelFor(size_t n, const std::function<void(size_t)>& fn);
+
+    static size_t DefaultThreadCount();
+};
@@ -1,11 +1,10 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
-std::string toString(const std::vector<uint8_t>& data);
-
-std::vector<uint8_t> getVecFromInt64(int64_t _v);
+std::string toString(const uint8_t* data, size_t length);
 
-bool getInt64FromVec(const std::vector<uint8_t>& data, int64_t *rtn);
+std::string toString(const std::vector<uint8_t>& data);
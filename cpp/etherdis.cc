@@ -6,59 +6,92 @@
 #include <map>
 #include <sstream>
 #include <algorithm>
+#include <mutex>
 #include <sys/stat.h>
+#include <dirent.h>
 
 #include "OpCodes.h"
 #include "Program.h"
 #include "AuditResult.h"
+#include "AuditEngine.h"
+#include "ThreadPool.h"
+#include "ByteCodeFile.h"
+#include "AnalysisCache.h"
+#include "Keccak.h"
+#include "SelectorDatabase.h"
 
-std::vector<uint8_t> parseByteCodeString(const std::string &str) {
-    const char *buff = str.c_str();
-    if (buff[1] == 'x')
-        buff += 2; // Eat '0x'
+#define COMMAND_LINE_FLAGS \
+XX(all) \
+XX(outdir) \
+XX(manifest) \
+XX(timing) \
+XX(selectors)
 
-    char scratch[3] = {};
+#define XX(name) bool name = false;
 
-    std::vector<uint8_t> rtn;
-    while (*buff) {
-        scratch[0] = buff[0];
-        scratch[1] = buff[1];
+COMMAND_LINE_FLAGS
 
-        rtn.push_back(strtol(scratch, 0, 16));
-        buff += 2;
-    }
+void createOutDir(const Program &program);
 
-    return rtn;
-}
+#undef XX
 
-std::string readFile(std::ifstream &fs) {
-    std::string rtn, line;
-    while (std::getline(fs, line))
-        rtn += line;
-    return rtn;
-}
+// Number of contracts analyzed at once; 0 means one per core
+size_t jobs = 1;
+
+// Set by '--cache DIR'; only used with --outdir
+std::unique_ptr<AnalysisCache> cache;
+
+// '--max-states N' caps the calling contexts kept per block; '--budget-ms',
+// '--budget-states', '--budget-paths' and '--budget-mb' limit each contract,
+// and '--function-budget-ms' and '--function-budget-states' each of its
+// dispatcher functions
+SolverOptions solverOptions;
+
+// '--timing' prints what each audit detector took to stderr
+std::mutex timingLock;
+
+// Set by '--compile-selector-db FILE', which compiles the inputs, entryPoints.csv
+// files, into FILE; '--selector-db FILE' reads selectors from a compiled FILE
+std::string selectorDbFile;
 
 void createOutDir(const std::string &dir, const Program &program) {
     mkdir(dir.c_str(), S_IRWXU);
 
+    // Only these go into the cache; anything else in dir is not ours
+    std::vector<std::string> written;
+    auto create = [&](const std::string &name) {
+        written.push_back(name);
+        return std::ofstream(dir + "/" + name);
+    };
+
     {
-        std::ofstream fs(dir + "/disassembly.txt");
+        auto fs = create("disassembly.txt");
         assert(fs);
         fs << DisassemReport(program, false, false);
     }
 
     {
-        std::ofstream fs(dir + "/disassembly.full.txt");
+        auto fs = create("disassembly.full.txt");
         fs << DisassemReport(program, true, true);
     }
 
     {
-        std::ofstream fs(dir + "/stackUsage.txt");
+        auto fs = create("stackUsage.txt");
         fs << PsuedoStackReport(program);
     }
 
+    {
+        auto fs = create("solver.txt");
+        fs << SolverReport(program);
+    }
+
+    {
+        auto fs = create("functions.txt");
+        fs << FunctionReport(program);
+    }
+
     if (!program.Issues().empty()) {
-        std::ofstream fs(dir + "/issues.log");
+        auto fs = create("issues.log");
         for (auto &issue : program.Issues()) {
             fs << issue << std::endl;
         }
@@ -66,88 +99,358 @@ void createOutDir(const std::string &dir, const Program &program) {
     }
 
     {
-        std::ofstream fs(dir + "/audit.log");
-        AuditResults audit = AuditForEverything(program);
-        for (auto &item : audit) {
+        auto fs = create("audit.log");
+        auto audit = RunAudit(program, AuditRegistry::Default(), timing);
+        for (auto &item : audit.results) {
             fs << "At offset " << item.Offset()
                << ": (" << item.Type().Severity() << ") "
                << item.Type().Message() << std::endl;
         }
+
+        // Kept out of the output directory, which has to be reproducible
+        if (timing) {
+            std::stringstream ss;
+            for (auto &stats : audit.stats) {
+                ss << dir << ": " << stats.name << ": " << stats.findings << " findings, "
+                   << stats.calls << " calls, "
+                   << std::chrono::duration_cast<std::chrono::microseconds>(stats.time).count() << "us" << std::endl;
+            }
+            std::lock_guard<std::mutex> l(timingLock);
+            std::cerr << ss.str();
+        }
     }
     {
-        std::ofstream fs(dir + "/symbols.txt");
+        auto fs = create("symbols.txt");
         for (auto &symbol : program.Symbols()) {
-            fs << "<#" << symbol.first << "> (" << symbol.second.createdAt << "): " << symbol.second.ToString(program) << std::endl;
+            fs << "<#" << symbol.first << "> (" << symbol.second.createdAt << "): " << program.RenderSymbol(symbol.first) << std::endl;
+            auto& ssa = program.SSA();
+            auto uses = ssa.Uses(ssa.OfSymbol(symbol.first));
             fs << "Used at: ";
-            for(auto& use : symbol.second.usedAt) {
-                fs << use << " ";
+            size_t last = SSAForm::npos;
+            for(auto& use : uses) {
+                // One instruction can read a value more than once
+                if(!use.isPhi && use.user != last) {
+                    fs << program.Store().Offset(use.user) << " ";
+                    last = use.user;
+                }
             }
             fs << std::endl;
+            if(std::any_of(uses.begin(), uses.end(), [](const SSAForm::Use& use) { return use.isPhi; })) {
+                fs << "Merged at: ";
+                last = SSAForm::npos;
+                for(auto& use : uses) {
+                    if(use.isPhi && ssa.DefinedAt(use.user) != last) {
+                        last = ssa.DefinedAt(use.user);
+                        fs << "loc_" << last << " ";
+                    }
+                }
+                fs << std::endl;
+            }
         }
     }
 
-    size_t i = 0;
-    for (auto &cc : program.createdContracts) {
-        if (!cc) continue;
-
+    for (size_t i = 0; i < program.createdContracts.size(); i++) {
         std::stringstream ss;
-        ss << "creates." << i++;
-        createOutDir(dir + "/" + ss.str(), *cc);
+        ss << "creates." << i;
+        auto &cc = program.createdContracts[i];
+        if (cc) {
+            createOutDir(dir + "/" + ss.str(), *cc);
+        } else if (cache && !cache->Restore(program.createdByteCodes[i], dir + "/" + ss.str())) {
+            // Only skipped when CanRestore said yes; build it if that no
+            // longer holds
+            Program created(program.createdByteCodes[i], cache.get(), solverOptions);
+            createOutDir(dir + "/" + ss.str(), created);
+        }
     }
 
+    // Partial results depend on the budget and, for time, on the machine
+    if (cache && !program.IsTruncated())
+        cache->Store(program.ByteCode(), dir, written, program.createdByteCodes);
 }
 
-#define COMMAND_LINE_FLAGS \
-XX(all) \
-XX(outdir)
+std::string outDirName(const std::string& fileName) {
+    auto dirName = fileName;
+    auto pos = dirName.find_last_of('.');
+    if (pos == std::string::npos) {
+        dirName = "_" + dirName;
+    } else {
+        while (dirName.size() > pos) {
+            dirName.pop_back();
+        }
+    }
+    return dirName;
+}
 
-#define XX(name) bool name = false;
+void addInputs(const std::string &path, std::vector<std::string> &files) {
+    struct stat st = {};
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        std::vector<std::string> entries;
+        if (DIR *dir = opendir(path.c_str())) {
+            while (auto entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                struct stat est = {};
+                if (stat((path + "/" + name).c_str(), &est) == 0 && S_ISREG(est.st_mode))
+                    entries.push_back(path + "/" + name);
+            }
+            closedir(dir);
+        }
+        // readdir order is arbitrary; keep batch output stable between runs
+        std::sort(entries.begin(), entries.end());
+        files.insert(files.end(), entries.begin(), entries.end());
+    } else if (manifest) {
+        std::ifstream fs(path);
+        if (!fs) {
+            std::cerr << "Could not read manifest '" << path << "'" << std::endl;
+            return;
+        }
 
-COMMAND_LINE_FLAGS
+        auto baseDir = path.find_last_of('/') == std::string::npos ? std::string() :
+                       path.substr(0, path.find_last_of('/') + 1);
+        std::string line;
+        while (std::getline(fs, line)) {
+            while (!line.empty() && isspace(line.back()))
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            files.push_back(line[0] == '/' ? line : baseDir + line);
+        }
+    } else {
+        files.push_back(path);
+    }
+}
 
-void createOutDir(const Program &program);
+void processFile(std::ostream &os, const std::string &fileName) {
+    MappedFile f(fileName);
+    if (!f.IsOpen()) {
+        os << "Could not open file '" << fileName << "'" << std::endl;
+        return;
+    }
 
-#undef XX
+    os << "Processing file '" << fileName << "'" << std::endl;
+    std::vector<uint8_t> bc;
+    std::string error;
+    if (!parseByteCode(f.Data(), f.Size(), bc, &error)) {
+        os << "Could not parse '" << fileName << "': " << error << std::endl;
+        return;
+    }
+
+    if (outdir && cache && cache->Restore(bc, outDirName(fileName)))
+        return;
+
+    Program p(bc, outdir ? cache.get() : nullptr, solverOptions);
+
+    if (outdir) {
+        createOutDir(outDirName(fileName), p);
+    } else {
+        p.print(os, all, all);
+    }
+}
+
+// Top level parameters of a signature, as written
+static std::vector<std::string> signatureParameters(const std::string &signature) {
+    std::vector<std::string> rtn;
+    auto open = signature.find('(');
+    if (open == std::string::npos)
+        return rtn;
+
+    int depth = 0;
+    std::string current;
+    for (size_t i = open + 1; i < signature.size(); i++) {
+        auto c = signature[i];
+        if ((c == ',' || c == ')') && depth == 0) {
+            if (current.find_first_not_of(" \t") != std::string::npos)
+                rtn.push_back(current);
+            current.clear();
+            if (c == ')')
+                break;
+            continue;
+        }
+        if (c == '(' || c == '[')
+            depth++;
+        if (c == ')' || c == ']')
+            depth--;
+        current += c;
+    }
+    return rtn;
+}
+
+// Name of a parameter written as "type [location] name", or "_"
+static std::string parameterName(const std::string &parameter) {
+    // Skip the type, tuple and array suffixes included
+    size_t i = parameter.find_first_not_of(" \t");
+    int depth = 0;
+    for (; i < parameter.size(); i++) {
+        auto c = parameter[i];
+        if (c == '(' || c == '[')
+            depth++;
+        else if (c == ')' || c == ']')
+            depth--;
+        else if (isspace((unsigned char)c) && depth == 0 && parameter.find_first_not_of(" \t", i) != std::string::npos &&
+                 parameter[parameter.find_first_not_of(" \t", i)] != '[')
+            break;
+    }
+
+    std::stringstream ss(parameter.substr(std::min(i, parameter.size())));
+    std::string word, name = "_";
+    while (ss >> word) {
+        if (word != "memory" && word != "calldata" && word != "storage" && word != "indexed")
+            name = word;
+    }
+    return name;
+}
+
+// '--selectors' reads files of function signatures, one per line, and
+// prints an entryPoints.csv line for each: selector, name, argument count,
+// argument names ('_' where the signature has none) and canonical types
+void printSelectors(const std::vector<std::string> &files) {
+    std::vector<std::string> signatures;
+    for (auto &fileName : files) {
+        std::ifstream fs(fileName);
+        if (!fs) {
+            std::cerr << "Could not read '" << fileName << "'" << std::endl;
+            continue;
+        }
+        std::string line;
+        while (std::getline(fs, line)) {
+            if (line.find('(') != std::string::npos)
+                signatures.push_back(line);
+        }
+    }
+
+    auto selectors = FunctionSelectors(signatures);
+    for (size_t i = 0; i < signatures.size(); i++) {
+        auto canonical = CanonicalSignature(signatures[i]);
+        auto types = signatureParameters(canonical);
+        std::vector<std::string> names;
+        for (auto &parameter : signatureParameters(signatures[i]))
+            names.push_back(parameterName(parameter));
+
+        char selector[9];
+        snprintf(selector, sizeof(selector), "%08x", selectors[i]);
+        std::cout << selector << " " << canonical.substr(0, canonical.find('(')) << " " << types.size();
+        for (auto &name : names)
+            std::cout << " " << name;
+        for (auto &type : types)
+            std::cout << " " << type;
+        std::cout << std::endl;
+    }
+}
 
 int main(int argc, const char **argv) {
-    int farg_start = -1;
-    for (size_t i = 1; i < argc; i++) {
+    std::vector<std::string> files;
+    std::string cacheDir;
+    for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
 #define XX(name) if(arg == "--"#name) name = true;
         COMMAND_LINE_FLAGS
 #undef XX
 
-        if (arg[0] != '-' && farg_start == -1)
-            farg_start = i;
+        if (arg == "--jobs" && i + 1 < argc) {
+            jobs = strtoul(argv[++i], 0, 10);
+            if (jobs == 0)
+                jobs = ThreadPool::DefaultThreadCount();
+        }
+        if (arg == "--cache" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        }
+        if (arg == "--selector-db" && i + 1 < argc) {
+            SetSelectorDatabasePath(argv[++i]);
+        }
+        if (arg == "--compile-selector-db" && i + 1 < argc) {
+            selectorDbFile = argv[++i];
+        }
+        if (arg == "--max-states" && i + 1 < argc) {
+            solverOptions.maxStatesPerNode = std::max(1ul, strtoul(argv[++i], 0, 10));
+        }
+        if (arg == "--budget-ms" && i + 1 < argc) {
+            solverOptions.budget.milliseconds = strtoul(argv[++i], 0, 10);
+        }
+        if (arg == "--budget-states" && i + 1 < argc) {
+            solverOptions.budget.states = strtoul(argv[++i], 0, 10);
+        }
+        if (arg == "--budget-paths" && i + 1 < argc) {
+            solverOptions.budget.paths = strtoul(argv[++i], 0, 10);
+        }
+        if (arg == "--budget-mb" && i + 1 < argc) {
+            solverOptions.budget.bytes = strtoul(argv[++i], 0, 10) << 20;
+        }
+        if (arg == "--function-budget-ms" && i + 1 < argc) {
+            solverOptions.functionBudget.milliseconds = strtoul(argv[++i], 0, 10);
+        }
+        if (arg == "--function-budget-states" && i + 1 < argc) {
+            solverOptions.functionBudget.states = strtoul(argv[++i], 0, 10);
+        }
+    }
+
+    if (!cacheDir.empty())
+        cache.reset(new AnalysisCache(cacheDir, solverOptions.Fingerprint()));
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--jobs" || arg == "--cache" || arg == "--max-states" ||
+            arg == "--selector-db" || arg == "--compile-selector-db" ||
+            arg == "--budget-ms" || arg == "--budget-states" || arg == "--budget-paths" || arg == "--budget-mb" ||
+            arg == "--function-budget-ms" || arg == "--function-budget-states") {
+            i++;
+            continue;
+        }
+        if (arg[0] != '-')
+            addInputs(arg, files);
     }
 
-    for (size_t farg = farg_start; farg < argc; farg++) {
-        std::string fileName = argv[farg];
-        std::ifstream f(fileName);
-        assert(f);
+    if (selectors) {
+        printSelectors(files);
+        return 0;
+    }
+
+    if (!selectorDbFile.empty()) {
+        std::string error;
+        if (!SelectorDatabase::Compile(files, selectorDbFile, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-        std::cout << "Processing file '" << fileName << "'" << std::endl;
-        auto bc = parseByteCodeString(readFile(f));
+    if (jobs <= 1) {
+        for (auto &fileName : files)
+            processFile(std::cout, fileName);
+        return 0;
+    }
 
-        Program p(bc);
+    // Results are buffered per contract and written in input order, so batch
+    // output matches a serial run byte for byte.
+    std::mutex outputLock;
+    std::vector<std::string> outputs(files.size());
+    std::vector<bool> isDone(files.size());
+    size_t nextOutput = 0;
 
-        if (outdir) {
-            auto dirName = fileName;
-            auto pos = dirName.find_last_of('.');
-            if (pos == std::string::npos) {
-                dirName = "_" + dirName;
-            } else {
-                while (dirName.size() > pos) {
-                    dirName.pop_back();
-                }
+    ThreadPool pool(jobs);
+    // Contracts share the pool with their own dispatcher functions, so a
+    // single large contract still spreads over every thread
+    solverOptions.pool = &pool;
+    for (size_t i = 0; i < files.size(); i++) {
+        pool.Submit([&, i] {
+            std::stringstream ss;
+            try {
+                processFile(ss, files[i]);
+            } catch (std::exception &e) {
+                ss << "Failed to process '" << files[i] << "': " << e.what() << std::endl;
             }
 
-            createOutDir(dirName, p);
-        } else {
-            p.print(all, all);
-        }
+            std::lock_guard<std::mutex> l(outputLock);
+            outputs[i] = ss.str();
+            isDone[i] = true;
+            while (nextOutput < files.size() && isDone[nextOutput]) {
+                std::cout << outputs[nextOutput];
+                outputs[nextOutput].clear();
+                nextOutput++;
+            }
+            std::cout.flush();
+        });
     }
+    pool.Wait();
+    solverOptions.pool = nullptr;
 
     return 0;
 }
-
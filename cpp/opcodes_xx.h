@@ -26,6 +26,9 @@ XX(OR, 0x17, 2, 1, 0)		///< bitwise OR operation
 XX(XOR, 0x18, 2, 1, 0)		///< bitwise XOR operation
 XX(NOT, 0x19, 1, 1, 0)		///< bitwise NOT opertation
 XX(BYTE, 0x1A, 2, 1, 0)		///< retrieve single byte from word
+XX(SHL, 0x1B, 2, 1, 0)		///< logical shift left
+XX(SHR, 0x1C, 2, 1, 0)		///< logical shift right
+XX(SAR, 0x1D, 2, 1, 0)		///< arithmetic shift right
 
 XX(SHA3, 0x20, 2, 1, 0)		///< compute SHA3-256 hash
 
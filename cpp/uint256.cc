@@ -0,0 +1,375 @@
+#include "uint256.h"
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+uint256 uint256::FromBigEndian(const uint8_t *data, size_t length) {
+    uint256 rtn;
+    if(length > 32) {
+        data += length - 32;
+        length = 32;
+    }
+    for(size_t i = 0;i < length;i++) {
+        size_t bit = (length - 1 - i) * 8;
+        rtn.limbs[bit / 64] |= (uint64_t)data[i] << (bit % 64);
+    }
+    return rtn;
+}
+
+void uint256::ToBigEndian(uint8_t *out) const {
+    for(size_t i = 0;i < 32;i++) {
+        size_t bit = (31 - i) * 8;
+        out[i] = (uint8_t)(limbs[bit / 64] >> (bit % 64));
+    }
+}
+
+size_t uint256::ByteLength() const {
+    for(int i = 3;i >= 0;i--) {
+        if(limbs[i])
+            return i * 8 + (64 - __builtin_clzll(limbs[i]) + 7) / 8;
+    }
+    return 0;
+}
+
+std::string uint256::ToHex() const {
+    static const char* hex = "0123456789abcdef";
+    uint8_t bytes[32];
+    ToBigEndian(bytes);
+
+    std::string rtn;
+    size_t i = 32 - (ByteLength() ? ByteLength() : 1);
+    for(;i < 32;i++) {
+        rtn.push_back(hex[bytes[i] >> 4]);
+        rtn.push_back(hex[bytes[i] & 0xf]);
+    }
+    return rtn;
+}
+
+uint256 &uint256::operator+=(const uint256 &rhs) {
+    uint64_t carry = 0;
+    for(size_t i = 0;i < 4;i++) {
+        uint128_t s = (uint128_t)limbs[i] + rhs.limbs[i] + carry;
+        limbs[i] = (uint64_t)s;
+        carry = (uint64_t)(s >> 64);
+    }
+    return *this;
+}
+
+uint256 &uint256::operator-=(const uint256 &rhs) {
+    uint64_t borrow = 0;
+    for(size_t i = 0;i < 4;i++) {
+        uint128_t d = (uint128_t)limbs[i] - rhs.limbs[i] - borrow;
+        limbs[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    return *this;
+}
+
+uint256 operator+(const uint256 &a, const uint256 &b) {
+    uint256 rtn = a;
+    return rtn += b;
+}
+
+uint256 operator-(const uint256 &a, const uint256 &b) {
+    uint256 rtn = a;
+    return rtn -= b;
+}
+
+uint256 operator-(const uint256 &a) {
+    return uint256() - a;
+}
+
+// out[0, an + bn) = a * b
+static void mulLimbs(const uint64_t* a, size_t an, const uint64_t* b, size_t bn, uint64_t* out, size_t outn) {
+    for(size_t i = 0;i < outn;i++)
+        out[i] = 0;
+    for(size_t i = 0;i < an;i++) {
+        uint64_t carry = 0;
+        for(size_t j = 0;j < bn && i + j < outn;j++) {
+            uint128_t p = (uint128_t)a[i] * b[j] + out[i + j] + carry;
+            out[i + j] = (uint64_t)p;
+            carry = (uint64_t)(p >> 64);
+        }
+        if(i + bn < outn)
+            out[i + bn] = carry;
+    }
+}
+
+uint256 operator*(const uint256 &a, const uint256 &b) {
+    uint256 rtn;
+    mulLimbs(a.limbs, 4, b.limbs, 4, rtn.limbs, 4);
+    return rtn;
+}
+
+static size_t significantLimbs(const uint64_t* v, size_t n) {
+    while(n > 0 && v[n - 1] == 0)
+        n--;
+    return n;
+}
+
+/***
+ * Knuth's algorithm D on 64 bit limbs. u has m limbs, v has n; q gets
+ * m - n + 1 limbs and r gets n. v must not be zero.
+ */
+static void divModLimbs(const uint64_t* u, size_t m, const uint64_t* v, size_t n, uint64_t* q, uint64_t* r) {
+    m = significantLimbs(u, m);
+    size_t vn = significantLimbs(v, n);
+
+    for(size_t i = 0;i < n;i++)
+        r[i] = 0;
+    if(m < vn) {
+        for(size_t i = 0;i < m;i++)
+            r[i] = u[i];
+        return;
+    }
+
+    if(vn == 1) {
+        uint64_t rem = 0;
+        for(size_t i = m;i-- > 0;) {
+            uint128_t num = ((uint128_t)rem << 64) | u[i];
+            q[i] = (uint64_t)(num / v[0]);
+            rem = (uint64_t)(num % v[0]);
+        }
+        r[0] = rem;
+        return;
+    }
+
+    // Normalize so the divisor's top bit is set
+    uint64_t vNorm[8], uNorm[9];
+    int s = __builtin_clzll(v[vn - 1]);
+    for(size_t i = vn - 1;i > 0;i--)
+        vNorm[i] = s ? (v[i] << s) | (v[i - 1] >> (64 - s)) : v[i];
+    vNorm[0] = v[0] << s;
+
+    uNorm[m] = s ? u[m - 1] >> (64 - s) : 0;
+    for(size_t i = m - 1;i > 0;i--)
+        uNorm[i] = s ? (u[i] << s) | (u[i - 1] >> (64 - s)) : u[i];
+    uNorm[0] = u[0] << s;
+
+    for(size_t j = m - vn + 1;j-- > 0;) {
+        uint128_t num = ((uint128_t)uNorm[j + vn] << 64) | uNorm[j + vn - 1];
+        uint128_t qhat = num / vNorm[vn - 1];
+        uint128_t rhat = num % vNorm[vn - 1];
+        while(qhat >> 64 ||
+              qhat * vNorm[vn - 2] > ((rhat << 64) | uNorm[j + vn - 2])) {
+            qhat--;
+            rhat += vNorm[vn - 1];
+            if(rhat >> 64)
+                break;
+        }
+
+        // Multiply and subtract
+        int128_t t = 0;
+        uint64_t k = 0;
+        for(size_t i = 0;i < vn;i++) {
+            uint128_t p = qhat * vNorm[i];
+            t = (int128_t)uNorm[i + j] - k - (uint64_t)p;
+            uNorm[i + j] = (uint64_t)t;
+            k = (uint64_t)(p >> 64) - (uint64_t)(t >> 64);
+        }
+        t = (int128_t)uNorm[j + vn] - k;
+        uNorm[j + vn] = (uint64_t)t;
+
+        q[j] = (uint64_t)qhat;
+        if(t < 0) {
+            // Subtracted one too many; add the divisor back
+            q[j]--;
+            uint64_t carry = 0;
+            for(size_t i = 0;i < vn;i++) {
+                uint128_t sum = (uint128_t)uNorm[i + j] + vNorm[i] + carry;
+                uNorm[i + j] = (uint64_t)sum;
+                carry = (uint64_t)(sum >> 64);
+            }
+            uNorm[j + vn] += carry;
+        }
+    }
+
+    for(size_t i = 0;i < vn;i++)
+        r[i] = s ? (uNorm[i] >> s) | (uNorm[i + 1] << (64 - s)) : uNorm[i];
+}
+
+static void divMod(const uint256& a, const uint256& b, uint256* q, uint256* r) {
+    uint64_t qLimbs[4] = {0, 0, 0, 0}, rLimbs[4];
+    if(b.IsZero()) {
+        if(q) *q = uint256();
+        if(r) *r = uint256();
+        return;
+    }
+    divModLimbs(a.limbs, 4, b.limbs, 4, qLimbs, rLimbs);
+    if(q) for(size_t i = 0;i < 4;i++) q->limbs[i] = qLimbs[i];
+    if(r) for(size_t i = 0;i < 4;i++) r->limbs[i] = rLimbs[i];
+}
+
+uint256 operator/(const uint256 &a, const uint256 &b) {
+    uint256 q;
+    divMod(a, b, &q, nullptr);
+    return q;
+}
+
+uint256 operator%(const uint256 &a, const uint256 &b) {
+    uint256 r;
+    divMod(a, b, nullptr, &r);
+    return r;
+}
+
+uint256 operator&(const uint256 &a, const uint256 &b) {
+    uint256 rtn;
+    for(size_t i = 0;i < 4;i++)
+        rtn.limbs[i] = a.limbs[i] & b.limbs[i];
+    return rtn;
+}
+
+uint256 operator|(const uint256 &a, const uint256 &b) {
+    uint256 rtn;
+    for(size_t i = 0;i < 4;i++)
+        rtn.limbs[i] = a.limbs[i] | b.limbs[i];
+    return rtn;
+}
+
+uint256 operator^(const uint256 &a, const uint256 &b) {
+    uint256 rtn;
+    for(size_t i = 0;i < 4;i++)
+        rtn.limbs[i] = a.limbs[i] ^ b.limbs[i];
+    return rtn;
+}
+
+uint256 operator~(const uint256 &a) {
+    uint256 rtn;
+    for(size_t i = 0;i < 4;i++)
+        rtn.limbs[i] = ~a.limbs[i];
+    return rtn;
+}
+
+uint256 operator<<(const uint256 &a, size_t shift) {
+    uint256 rtn;
+    if(shift >= 256)
+        return rtn;
+    size_t limbShift = shift / 64, bitShift = shift % 64;
+    for(size_t i = limbShift;i < 4;i++) {
+        uint64_t v = a.limbs[i - limbShift] << bitShift;
+        if(bitShift && i > limbShift)
+            v |= a.limbs[i - limbShift - 1] >> (64 - bitShift);
+        rtn.limbs[i] = v;
+    }
+    return rtn;
+}
+
+uint256 operator>>(const uint256 &a, size_t shift) {
+    uint256 rtn;
+    if(shift >= 256)
+        return rtn;
+    size_t limbShift = shift / 64, bitShift = shift % 64;
+    for(size_t i = 0;i + limbShift < 4;i++) {
+        uint64_t v = a.limbs[i + limbShift] >> bitShift;
+        if(bitShift && i + limbShift + 1 < 4)
+            v |= a.limbs[i + limbShift + 1] << (64 - bitShift);
+        rtn.limbs[i] = v;
+    }
+    return rtn;
+}
+
+// Shift amounts at or past 256 all behave the same
+static size_t shiftAmount(const uint256& shift) {
+    return shift.FitsUInt64() && shift.Low64() < 256 ? shift.Low64() : 256;
+}
+
+uint256 evm::sdiv(const uint256 &a, const uint256 &b) {
+    if(b.IsZero())
+        return uint256();
+    uint256 q = (a.IsNegative() ? -a : a) / (b.IsNegative() ? -b : b);
+    return a.IsNegative() != b.IsNegative() ? -q : q;
+}
+
+uint256 evm::smod(const uint256 &a, const uint256 &b) {
+    if(b.IsZero())
+        return uint256();
+    uint256 r = (a.IsNegative() ? -a : a) % (b.IsNegative() ? -b : b);
+    return a.IsNegative() ? -r : r;
+}
+
+uint256 evm::addmod(const uint256 &a, const uint256 &b, const uint256 &n) {
+    if(n.IsZero())
+        return uint256();
+
+    // The sum needs a 257th bit
+    uint64_t sum[5], q[5], r[4];
+    uint64_t carry = 0;
+    for(size_t i = 0;i < 4;i++) {
+        uint128_t s = (uint128_t)a.limbs[i] + b.limbs[i] + carry;
+        sum[i] = (uint64_t)s;
+        carry = (uint64_t)(s >> 64);
+    }
+    sum[4] = carry;
+
+    divModLimbs(sum, 5, n.limbs, 4, q, r);
+    uint256 rtn;
+    for(size_t i = 0;i < 4;i++)
+        rtn.limbs[i] = r[i];
+    return rtn;
+}
+
+uint256 evm::mulmod(const uint256 &a, const uint256 &b, const uint256 &n) {
+    if(n.IsZero())
+        return uint256();
+
+    uint64_t product[8], q[8], r[4];
+    mulLimbs(a.limbs, 4, b.limbs, 4, product, 8);
+    divModLimbs(product, 8, n.limbs, 4, q, r);
+    uint256 rtn;
+    for(size_t i = 0;i < 4;i++)
+        rtn.limbs[i] = r[i];
+    return rtn;
+}
+
+uint256 evm::exp(const uint256 &base, const uint256 &exponent) {
+    uint256 rtn(1), b = base;
+    size_t bits = exponent.ByteLength() * 8;
+    for(size_t i = 0;i < bits;i++) {
+        if((exponent.limbs[i / 64] >> (i % 64)) & 1)
+            rtn = rtn * b;
+        b = b * b;
+    }
+    return rtn;
+}
+
+uint256 evm::signextend(const uint256 &byteIndex, const uint256 &value) {
+    if(!byteIndex.FitsUInt64() || byteIndex.Low64() >= 31)
+        return value;
+    size_t bit = byteIndex.Low64() * 8 + 7;
+    uint256 mask = (uint256(1) << (bit + 1)) - uint256(1);
+    bool isSet = (value.limbs[bit / 64] >> (bit % 64)) & 1;
+    return isSet ? value | ~mask : value & mask;
+}
+
+uint256 evm::byte(const uint256 &index, const uint256 &value) {
+    if(!index.FitsUInt64() || index.Low64() >= 32)
+        return uint256();
+    return (value >> (8 * (31 - index.Low64()))) & uint256(0xff);
+}
+
+uint256 evm::shl(const uint256 &shift, const uint256 &value) {
+    return value << shiftAmount(shift);
+}
+
+uint256 evm::shr(const uint256 &shift, const uint256 &value) {
+    return value >> shiftAmount(shift);
+}
+
+uint256 evm::sar(const uint256 &shift, const uint256 &value) {
+    size_t s = shiftAmount(shift);
+    if(!value.IsNegative())
+        return value >> s;
+    if(s >= 256)
+        return ~uint256();
+    return ~(~value >> s);
+}
+
+bool evm::slt(const uint256 &a, const uint256 &b) {
+    if(a.IsNegative() != b.IsNegative())
+        return a.IsNegative();
+    return a < b;
+}
+
+bool evm::sgt(const uint256 &a, const uint256 &b) {
+    return slt(b, a);
+}
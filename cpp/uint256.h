@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+
+/***
+ * Fixed size 256 bit unsigned integer with EVM wraparound semantics. Four
+ * little endian 64 bit limbs; never allocates. Signed operations treat the
+ * value as two's complement, as the EVM does.
+ */
+struct uint256 {
+    uint64_t limbs[4] = {0, 0, 0, 0};
+
+    constexpr uint256() = default;
+    constexpr uint256(uint64_t v) : limbs{v, 0, 0, 0} {}
+    constexpr uint256(uint64_t l3, uint64_t l2, uint64_t l1, uint64_t l0) : limbs{l0, l1, l2, l3} {}
+
+    // Reads up to 32 big endian bytes; longer input keeps the low 32
+    static uint256 FromBigEndian(const uint8_t* data, size_t length);
+    void ToBigEndian(uint8_t out[32]) const;
+
+    // Bytes needed to hold the value, 0 for zero
+    size_t ByteLength() const;
+
+    bool IsZero() const { return (limbs[0] | limbs[1] | limbs[2] | limbs[3]) == 0; }
+    bool FitsUInt64() const { return (limbs[1] | limbs[2] | limbs[3]) == 0; }
+    uint64_t Low64() const { return limbs[0]; }
+    bool IsNegative() const { return limbs[3] >> 63; }
+
+    std::string ToHex() const;
+
+    uint256& operator+=(const uint256& rhs);
+    uint256& operator-=(const uint256& rhs);
+};
+
+uint256 operator+(const uint256& a, const uint256& b);
+uint256 operator-(const uint256& a, const uint256& b);
+uint256 operator-(const uint256& a);
+uint256 operator*(const uint256& a, const uint256& b);
+// Division and modulo by zero give zero, as in the EVM
+uint256 operator/(const uint256& a, const uint256& b);
+uint256 operator%(const uint256& a, const uint256& b);
+uint256 operator&(const uint256& a, const uint256& b);
+uint256 operator|(const uint256& a, const uint256& b);
+uint256 operator^(const uint256& a, const uint256& b);
+uint256 operator~(const uint256& a);
+uint256 operator<<(const uint256& a, size_t shift);
+uint256 operator>>(const uint256& a, size_t shift);
+
+inline bool operator==(const uint256& a, const uint256& b) {
+    return a.limbs[0] == b.limbs[0] && a.limbs[1] == b.limbs[1] &&
+           a.limbs[2] == b.limbs[2] && a.limbs[3] == b.limbs[3];
+}
+inline bool operator!=(const uint256& a, const uint256& b) { return !(a == b); }
+inline bool operator<(const uint256& a, const uint256& b) {
+    for(int i = 3;i >= 0;i--) {
+        if(a.limbs[i] != b.limbs[i])
+            return a.limbs[i] < b.limbs[i];
+    }
+    return false;
+}
+inline bool operator>(const uint256& a, const uint256& b) { return b < a; }
+inline bool operator<=(const uint256& a, const uint256& b) { return !(b < a); }
+inline bool operator>=(const uint256& a, const uint256& b) { return !(a < b); }
+
+/***
+ * The remaining EVM arithmetic, argument order matching the opcode's stack
+ * order (first argument is the top of the stack).
+ */
+namespace evm {
+    uint256 sdiv(const uint256& a, const uint256& b);
+    uint256 smod(const uint256& a, const uint256& b);
+    uint256 addmod(const uint256& a, const uint256& b, const uint256& n);
+    uint256 mulmod(const uint256& a, const uint256& b, const uint256& n);
+    uint256 exp(const uint256& base, const uint256& exponent);
+    uint256 signextend(const uint256& byteIndex, const uint256& value);
+    uint256 byte(const uint256& index, const uint256& value);
+    uint256 shl(const uint256& shift, const uint256& value);
+    uint256 shr(const uint256& shift, const uint256& value);
+    uint256 sar(const uint256& shift, const uint256& value);
+    bool slt(const uint256& a, const uint256& b);
+    bool sgt(const uint256& a, const uint256& b);
+}